@@ -1,14 +1,25 @@
 from __future__ import annotations
+import base64
+import json
 from datetime import date
-from typing import List, Optional
-from fastapi import FastAPI, HTTPException, Depends
+from typing import List, Literal, Optional
+from fastapi import FastAPI, HTTPException, Depends, Query, Request, Response
 from pydantic import BaseModel, Field
 from sqlalchemy.orm import Session
-from sqlalchemy import func
-from .database import Base, engine, SessionLocal
-from .models import Movie as MovieORM
+from sqlalchemy import and_, func, or_
+from .database import Base, engine, SessionLocal, WriteSessionLocal, migrate_schema
+from .models import Movie as MovieORM, MovieTombstone, current_revision, next_revision
+
+try:
+    import cbor2
+except ImportError:  # CBOR is optional; clients fall back to JSON
+    cbor2 = None
+
+CBOR_MEDIA_TYPE = "application/cbor"
+CBOR_EPOCH = date(1970, 1, 1)
 
 Base.metadata.create_all(bind=engine)
+migrate_schema()
 
 app = FastAPI(title="MovieReviewApp API")
 
@@ -20,6 +31,7 @@ class Movie(BaseModel):
     date_added: date
     notes: str = ""
     is_favorite: bool = False
+    id: Optional[int] = None
 
 
 class MovieCreate(BaseModel):
@@ -42,6 +54,12 @@ class MovieUpdate(BaseModel):
     updated: Movie
 
 
+class MovieChanges(BaseModel):
+    revision: int
+    upserts: List[Movie]
+    deletes: List[int]
+
+
 def get_db():
     db = SessionLocal()
     try:
@@ -50,24 +68,182 @@ def get_db():
         db.close()
 
 
-@app.get("/movies", response_model=List[Movie])
-def list_movies(db: Session = Depends(get_db)):
-    rows = db.query(MovieORM).order_by(MovieORM.date_added.desc(), MovieORM.id.desc()).all()
+def get_write_db():
+    db = WriteSessionLocal()
+    try:
+        yield db
+    finally:
+        db.close()
+
+
+def to_api(row: MovieORM) -> Movie:
+    return Movie(
+        id=row.id,
+        name=row.name,
+        year=row.year,
+        director=row.director or "",
+        date_added=row.date_added,
+        notes=row.notes or "",
+        is_favorite=row.is_favorite,
+    )
+
+
+def wants_cbor(request: Request) -> bool:
+    return cbor2 is not None and CBOR_MEDIA_TYPE in request.headers.get("accept", "")
+
+
+def to_cbor_record(row: MovieORM) -> list:
+    """Positional record matching Movie::fromCbor in the client:
+    [id, name, year, director, date_added (days since 1970-01-01), notes, is_favorite]
+    """
     return [
-        Movie(
-            name=row.name,
-            year=row.year,
-            director=row.director or "",
-            date_added=row.date_added,
-            notes=row.notes or "",
-            is_favorite=row.is_favorite,
-        )
-        for row in rows
+        row.id,
+        row.name,
+        row.year,
+        row.director or "",
+        (row.date_added - CBOR_EPOCH).days if row.date_added else None,
+        row.notes or "",
+        bool(row.is_favorite),
     ]
 
 
-@app.post("/movies", response_model=Movie)
-def create_movie(payload: MovieCreate, db: Session = Depends(get_db)):
+def cbor_response(payload, headers: Optional[dict] = None) -> Response:
+    headers = dict(headers or {})
+    headers["Vary"] = "Accept"
+    return Response(content=cbor2.dumps(payload), media_type=CBOR_MEDIA_TYPE, headers=headers)
+
+
+# Sort keys accepted by GET /movies: (sort expression, descending). Ties are broken by id
+# in the same direction, which makes the order total and the keyset cursor exact.
+SORT_ORDERS = {
+    "date_desc": (MovieORM.date_added, True),
+    "date_asc": (MovieORM.date_added, False),
+    "name_asc": (func.lower(MovieORM.name), False),
+    "name_desc": (func.lower(MovieORM.name), True),
+    "year_desc": (MovieORM.year, True),
+    "year_asc": (MovieORM.year, False),
+}
+
+
+def encode_cursor(value, row_id: int) -> str:
+    if isinstance(value, date):
+        value = value.isoformat()
+    raw = json.dumps([value, row_id]).encode()
+    return base64.urlsafe_b64encode(raw).decode().rstrip("=")
+
+
+def decode_cursor(cursor: str, sort: str):
+    try:
+        padded = cursor + "=" * (-len(cursor) % 4)
+        value, row_id = json.loads(base64.urlsafe_b64decode(padded))
+        if sort.startswith("date"):
+            value = date.fromisoformat(value)
+        return value, int(row_id)
+    except (ValueError, TypeError):
+        raise HTTPException(status_code=400, detail="Invalid cursor")
+
+
+def escape_like(text: str) -> str:
+    return text.replace("\\", "\\\\").replace("%", "\\%").replace("_", "\\_")
+
+
+@app.get("/movies", response_model=List[Movie])
+def list_movies(
+    request: Request,
+    response: Response,
+    name: Optional[str] = None,
+    director: Optional[str] = None,
+    added_from: Optional[date] = None,
+    added_to: Optional[date] = None,
+    favorites: bool = False,
+    sort: str = "date_desc",
+    limit: Optional[int] = Query(None, ge=1, le=1000),
+    after: Optional[str] = None,
+    db: Session = Depends(get_db),
+):
+    """Movies matching the filters, in `sort` order.
+
+    Without `limit` the whole result is returned. With `limit`, at most that many
+    rows come back and `X-Next-Cursor` is set when there are more; pass it as
+    `after` to get the next page.
+    """
+    if sort not in SORT_ORDERS:
+        raise HTTPException(status_code=400, detail=f"Unknown sort key: {sort}")
+    # Read the cursor before the rows: a concurrent write then shows up again
+    # in the next delta instead of being missed.
+    revision = str(current_revision(db))
+    column, descending = SORT_ORDERS[sort]
+    query = db.query(MovieORM, column)
+    if name:
+        query = query.filter(MovieORM.name.ilike(f"%{escape_like(name)}%", escape="\\"))
+    if director:
+        query = query.filter(MovieORM.director.ilike(f"%{escape_like(director)}%", escape="\\"))
+    if added_from is not None:
+        query = query.filter(MovieORM.date_added >= added_from)
+    if added_to is not None:
+        query = query.filter(MovieORM.date_added <= added_to)
+    if favorites:
+        query = query.filter(MovieORM.is_favorite.is_(True))
+    if after:
+        value, last_id = decode_cursor(after, sort)
+        if descending:
+            query = query.filter(or_(column < value, and_(column == value, MovieORM.id < last_id)))
+        else:
+            query = query.filter(or_(column > value, and_(column == value, MovieORM.id > last_id)))
+    if descending:
+        query = query.order_by(column.desc(), MovieORM.id.desc())
+    else:
+        query = query.order_by(column.asc(), MovieORM.id.asc())
+
+    headers = {"X-Movies-Revision": revision}
+    if limit is None:
+        results = query.all()
+    else:
+        # One extra row tells us whether another page exists
+        results = query.limit(limit + 1).all()
+        if len(results) > limit:
+            results = results[:limit]
+            last_row, last_value = results[-1]
+            headers["X-Next-Cursor"] = encode_cursor(last_value, last_row.id)
+    rows = [row for row, _ in results]
+
+    if wants_cbor(request):
+        return cbor_response([to_cbor_record(row) for row in rows], headers)
+    response.headers.update(headers)
+    response.headers["Vary"] = "Accept"
+    return [to_api(row) for row in rows]
+
+
+@app.get("/movies/changes", response_model=MovieChanges)
+def list_changes(request: Request, response: Response, since: int = 0, db: Session = Depends(get_db)):
+    """Rows created/updated and ids deleted after revision `since`.
+
+    Clients apply `deletes` first and then `upserts` (keyed by id), then keep
+    `revision` as the cursor for the next call.
+    """
+    revision = current_revision(db)
+    rows = db.query(MovieORM).filter(MovieORM.revision > since).order_by(MovieORM.revision).all()
+    tombstones = (
+        db.query(MovieTombstone.movie_id)
+        .filter(MovieTombstone.revision > since)
+        .order_by(MovieTombstone.revision)
+        .all()
+    )
+    if wants_cbor(request):
+        return cbor_response({
+            "revision": revision,
+            "upserts": [to_cbor_record(row) for row in rows],
+            "deletes": [t.movie_id for t in tombstones],
+        })
+    response.headers["Vary"] = "Accept"
+    return MovieChanges(
+        revision=revision,
+        upserts=[to_api(row) for row in rows],
+        deletes=[t.movie_id for t in tombstones],
+    )
+
+
+def apply_create(db: Session, payload: MovieCreate) -> MovieORM:
     effective_date = payload.date_added or date.today()
     # Prevent duplicates by name (case-insensitive) + year regardless of date
     duplicate = (
@@ -87,74 +263,149 @@ def create_movie(payload: MovieCreate, db: Session = Depends(get_db)):
         date_added=effective_date,
         notes=(payload.notes or "").strip(),
         is_favorite=bool(payload.is_favorite),
+        revision=next_revision(db),
     )
     db.add(entity)
-    try:
-        db.commit()
-    except Exception as exc:
-        db.rollback()
-        raise HTTPException(status_code=400, detail=f"Could not create movie: {exc}")
-    db.refresh(entity)
-    return Movie(
-        name=entity.name,
-        year=entity.year,
-        director=entity.director or "",
-        date_added=entity.date_added,
-        notes=entity.notes or "",
-        is_favorite=entity.is_favorite,
-    )
+    db.flush()
+    return entity
 
 
-@app.put("/movies", response_model=Movie)
-def update_movie(payload: MovieUpdate, db: Session = Depends(get_db)):
+def find_by_identity(db: Session, key: MovieKey) -> MovieORM:
     row = (
         db.query(MovieORM)
         .filter(
-            MovieORM.name == payload.original.name,
-            MovieORM.year == payload.original.year,
-            MovieORM.date_added == payload.original.date_added,
+            MovieORM.name == key.name,
+            MovieORM.year == key.year,
+            MovieORM.date_added == key.date_added,
         )
         .one_or_none()
     )
     if row is None:
         raise HTTPException(status_code=404, detail="Movie not found")
+    return row
+
+
+def apply_update(db: Session, original: MovieKey, updated: Movie) -> MovieORM:
+    row = find_by_identity(db, original)
+    row.name = updated.name.strip()
+    row.year = updated.year
+    row.director = (updated.director or "").strip()
+    row.date_added = updated.date_added
+    row.notes = (updated.notes or "").strip()
+    row.is_favorite = bool(updated.is_favorite)
+    row.revision = next_revision(db)
+    db.flush()
+    return row
+
+
+def apply_delete(db: Session, key: MovieKey) -> None:
+    row = find_by_identity(db, key)
+    db.add(MovieTombstone(movie_id=row.id, revision=next_revision(db)))
+    db.delete(row)
+    db.flush()
 
-    row.name = payload.updated.name.strip()
-    row.year = payload.updated.year
-    row.director = (payload.updated.director or "").strip()
-    row.date_added = payload.updated.date_added
-    row.notes = (payload.updated.notes or "").strip()
-    row.is_favorite = bool(payload.updated.is_favorite)
 
+@app.post("/movies", response_model=Movie)
+def create_movie(payload: MovieCreate, db: Session = Depends(get_write_db)):
     try:
+        entity = apply_create(db, payload)
         db.commit()
+    except HTTPException:
+        db.rollback()
+        raise
+    except Exception as exc:
+        db.rollback()
+        raise HTTPException(status_code=400, detail=f"Could not create movie: {exc}")
+    db.refresh(entity)
+    return to_api(entity)
+
+
+@app.put("/movies", response_model=Movie)
+def update_movie(payload: MovieUpdate, db: Session = Depends(get_write_db)):
+    try:
+        row = apply_update(db, payload.original, payload.updated)
+        db.commit()
+    except HTTPException:
+        db.rollback()
+        raise
     except Exception as exc:
         db.rollback()
         raise HTTPException(status_code=400, detail=f"Could not update movie: {exc}")
     db.refresh(row)
-    return Movie(
-        name=row.name,
-        year=row.year,
-        director=row.director or "",
-        date_added=row.date_added,
-        notes=row.notes or "",
-        is_favorite=row.is_favorite,
-    )
+    return to_api(row)
 
 
 @app.post("/movies/delete")
-def delete_movie(payload: MovieKey, db: Session = Depends(get_db)):
-    row = (
-        db.query(MovieORM)
-        .filter(
-            MovieORM.name == payload.name,
-            MovieORM.year == payload.year,
-            MovieORM.date_added == payload.date_added,
-        )
-        .one_or_none()
-    )
-    if row is None:
-        raise HTTPException(status_code=404, detail="Movie not found")
-    db.delete(row)
+def delete_movie(payload: MovieKey, db: Session = Depends(get_write_db)):
+    apply_delete(db, payload)
     db.commit()
     return {"ok": True}
+
+
+class BatchOperation(BaseModel):
+    """One write in a batch. `create` uses `movie`; `update` uses `original` and
+    `updated`; `delete` uses `original`."""
+    op: Literal["create", "update", "delete"]
+    movie: Optional[MovieCreate] = None
+    original: Optional[MovieKey] = None
+    updated: Optional[Movie] = None
+
+
+class BatchRequest(BaseModel):
+    operations: List[BatchOperation] = Field(..., max_length=1000)
+
+
+class BatchResult(BaseModel):
+    # Status the single-operation endpoint would have answered with
+    status: int
+    movie: Optional[Movie] = None
+    detail: Optional[str] = None
+
+
+class BatchResponse(BaseModel):
+    revision: int
+    results: List[BatchResult]
+
+
+def apply_operation(db: Session, operation: BatchOperation) -> Optional[Movie]:
+    if operation.op == "create":
+        if operation.movie is None:
+            raise HTTPException(status_code=422, detail="create needs 'movie'")
+        return to_api(apply_create(db, operation.movie))
+    if operation.original is None:
+        raise HTTPException(status_code=422, detail=f"{operation.op} needs 'original'")
+    if operation.op == "update":
+        if operation.updated is None:
+            raise HTTPException(status_code=422, detail="update needs 'updated'")
+        return to_api(apply_update(db, operation.original, operation.updated))
+    apply_delete(db, operation.original)
+    return None
+
+
+@app.post("/movies/batch", response_model=BatchResponse)
+def batch_write(payload: BatchRequest, db: Session = Depends(get_write_db)):
+    """Apply mixed create/update/delete operations in order, in one transaction.
+
+    Each operation runs in its own savepoint, so a failing one (duplicate, not
+    found, constraint violation) is rolled back and reported in its result while
+    the others still commit together.
+    """
+    results: List[BatchResult] = []
+    for operation in payload.operations:
+        savepoint = db.begin_nested()
+        try:
+            movie = apply_operation(db, operation)
+            savepoint.commit()
+            results.append(BatchResult(status=200, movie=movie))
+        except HTTPException as exc:
+            savepoint.rollback()
+            results.append(BatchResult(status=exc.status_code, detail=str(exc.detail)))
+        except Exception as exc:
+            savepoint.rollback()
+            results.append(BatchResult(status=400, detail=f"Could not apply {operation.op}: {exc}"))
+    try:
+        db.commit()
+    except Exception as exc:
+        db.rollback()
+        raise HTTPException(status_code=400, detail=f"Could not commit batch: {exc}")
+    return BatchResponse(revision=current_revision(db), results=results)
@@ -1,7 +1,7 @@
 from __future__ import annotations
 from pathlib import Path
 import os
-from sqlalchemy import create_engine
+from sqlalchemy import create_engine, event, inspect, text
 from sqlalchemy.orm import sessionmaker, declarative_base
 
 Base = declarative_base()
@@ -29,4 +29,49 @@ def get_database_url() -> str:
 engine = create_engine(
     get_database_url(), connect_args={"check_same_thread": False}
 )
+
+
+# pysqlite manages transactions itself and breaks SAVEPOINT (used by
+# POST /movies/batch); let SQLAlchemy emit BEGIN instead.
+@event.listens_for(engine, "connect")
+def _disable_pysqlite_transactions(dbapi_connection, _record):
+    dbapi_connection.isolation_level = None
+
+
+def _unicode_lower(value):
+    return value.lower() if isinstance(value, str) else value
+
+
+# SQLite's built-in lower() folds ASCII only. Replace it with Python's, so the
+# name sort, the ilike filters (rendered as lower() LIKE lower()) and the
+# duplicate check fold "É" like the "é" that str.lower() gives the payload side,
+# and like the clients and the mock server do.
+@event.listens_for(engine, "connect")
+def _register_unicode_lower(dbapi_connection, _record):
+    dbapi_connection.create_function("lower", 1, _unicode_lower, deterministic=True)
+
+
+# Writers take the write lock up front (BEGIN IMMEDIATE): revisions are read as
+# max(revision) + 1, and two deferred transactions could both read the same
+# maximum before either writes, or fail with "database is locked" on upgrade.
+@event.listens_for(engine, "begin")
+def _begin_transaction(connection):
+    if connection.get_execution_options().get("sqlite_immediate"):
+        connection.exec_driver_sql("BEGIN IMMEDIATE")
+    else:
+        connection.exec_driver_sql("BEGIN")
+
+
 SessionLocal = sessionmaker(autocommit=False, autoflush=False, bind=engine)
+WriteSessionLocal = sessionmaker(
+    autocommit=False, autoflush=False, bind=engine.execution_options(sqlite_immediate=True)
+)
+
+
+def migrate_schema() -> None:
+    """Add columns introduced after the initial schema to existing DB files."""
+    columns = {col["name"] for col in inspect(engine).get_columns("movies")}
+    if "revision" not in columns:
+        with engine.begin() as conn:
+            conn.execute(text("ALTER TABLE movies ADD COLUMN revision INTEGER NOT NULL DEFAULT 0"))
+            conn.execute(text("CREATE INDEX IF NOT EXISTS ix_movies_revision ON movies (revision)"))
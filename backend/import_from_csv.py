@@ -3,10 +3,11 @@ from pathlib import Path
 import csv
 from datetime import datetime, date
 import os
-from .database import Base, engine, SessionLocal, get_project_root, get_db_path
-from .models import Movie
+from .database import Base, engine, WriteSessionLocal, get_project_root, get_db_path, migrate_schema
+from .models import Movie, next_revision
 
 Base.metadata.create_all(bind=engine)
+migrate_schema()
 
 
 def parse_bool(value: str) -> bool:
@@ -20,7 +21,8 @@ def main() -> None:
         print(f"CSV not found at {csv_path}")
         return
 
-    with SessionLocal() as db:
+    with WriteSessionLocal() as db:
+        revision = next_revision(db)
         with csv_path.open(newline="", encoding="utf-8") as f:
             reader = csv.DictReader(f)
             count = 0
@@ -44,6 +46,7 @@ def main() -> None:
                     date_added=d,
                     notes=notes,
                     is_favorite=fav,
+                    revision=revision,
                 )
                 # Upsert-like behavior based on unique constraint
                 existing = (
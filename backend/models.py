@@ -1,7 +1,7 @@
 from __future__ import annotations
 from datetime import date
-from sqlalchemy import Integer, String, Boolean, Date, UniqueConstraint
-from sqlalchemy.orm import Mapped, mapped_column
+from sqlalchemy import Integer, String, Boolean, Date, UniqueConstraint, func
+from sqlalchemy.orm import Mapped, mapped_column, Session
 from .database import Base
 
 
@@ -14,7 +14,27 @@ class Movie(Base):
     date_added: Mapped[date] = mapped_column(Date, nullable=False)
     notes: Mapped[str] = mapped_column(String, default="")
     is_favorite: Mapped[bool] = mapped_column(Boolean, default=False, nullable=False)
+    # Change cursor: bumped on every create/update so clients can fetch deltas
+    revision: Mapped[int] = mapped_column(Integer, default=0, nullable=False, index=True)
 
     __table_args__ = (
         UniqueConstraint("name", "year", "date_added", name="uq_movie_identity"),
     )
+
+
+class MovieTombstone(Base):
+    """Records a deleted movie id so delta clients can drop it locally."""
+    __tablename__ = "movie_tombstones"
+    id: Mapped[int] = mapped_column(Integer, primary_key=True, autoincrement=True)
+    movie_id: Mapped[int] = mapped_column(Integer, nullable=False)
+    revision: Mapped[int] = mapped_column(Integer, nullable=False, index=True)
+
+
+def current_revision(db: Session) -> int:
+    latest_movie = db.query(func.max(Movie.revision)).scalar() or 0
+    latest_tombstone = db.query(func.max(MovieTombstone.revision)).scalar() or 0
+    return max(latest_movie, latest_tombstone)
+
+
+def next_revision(db: Session) -> int:
+    return current_revision(db) + 1
@@ -0,0 +1,346 @@
+// ============== MovieBench.cpp ==============
+// movie_bench: times the hot paths of the app on synthetic collections and
+// prints the results as JSON, so runs can be stored and compared.
+//
+//   movie_bench [--sizes 1000,10000,100000,1000000] [--seed N] [--filter text] [--output file.json]
+//               [--latency ms] [--bandwidth KiB/s] [--trace file.json]
+#include "MainWindow.h"
+#include "mockmovieserver.h"
+#include "moviegenerator.h"
+#include "snapshotfile.h"
+#include "tracing.h"
+#include <QApplication>
+#include <QCommandLineParser>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSignalBlocker>
+#include <QSysInfo>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <QThread>
+#include <algorithm>
+#include <functional>
+
+class MovieBench {
+public:
+    MovieBench(quint32 seed, const QString& filter) : m_seed(seed), m_filter(filter) {}
+
+    // Network conditions of the mock server used by the API benchmarks
+    void setNetwork(const MockMovieServer::Options& options) { m_network = options; }
+
+    void run(int n);
+    QJsonObject report() const;
+
+private:
+    // Runs fn iterations times; each run handles items items (movies or one query)
+    void measure(const QString& name, int n, int iterations, qint64 items, const std::function<void(int)>& fn);
+    void benchSerialization(int n, const QVector<Movie>& movies);
+    void benchDatabase(int n, const QVector<Movie>& movies);
+    void benchWindow(int n, MovieDatabase* database);
+    void benchNetwork(int n, const QVector<Movie>& movies);
+
+    quint32 m_seed;
+    QString m_filter;
+    MockMovieServer::Options m_network;
+    QJsonArray m_results;
+    quint64 m_checksum = 0; // consumes results so the compiler can't drop the work
+};
+
+void MovieBench::measure(const QString& name, int n, int iterations, qint64 items,
+                         const std::function<void(int)>& fn) {
+    if (!m_filter.isEmpty() && !name.contains(m_filter, Qt::CaseInsensitive)) {
+        return;
+    }
+    QVector<double> times;
+    times.reserve(iterations);
+    QElapsedTimer timer;
+    for (int i = 0; i < iterations; ++i) {
+        timer.start();
+        fn(i);
+        times.append(timer.nsecsElapsed() / 1e6);
+    }
+    std::sort(times.begin(), times.end());
+    double total = 0;
+    for (double t : times) {
+        total += t;
+    }
+    const double median = times[times.size() / 2];
+
+    QJsonObject result;
+    result["name"] = name;
+    result["n"] = n;
+    result["iterations"] = iterations;
+    result["items_per_iteration"] = items;
+    result["min_ms"] = times.first();
+    result["median_ms"] = median;
+    result["mean_ms"] = total / iterations;
+    result["max_ms"] = times.last();
+    result["ns_per_item"] = items > 0 ? median * 1e6 / double(items) : 0.0;
+    m_results.append(result);
+    QTextStream(stderr) << QString("  %1  n=%2  median %3 ms\n").arg(name, -44).arg(n).arg(median, 0, 'f', 3);
+}
+
+void MovieBench::run(int n) {
+    QTextStream(stderr) << "Generating " << n << " movies\n";
+    MovieGenerator generator(m_seed);
+    const QVector<Movie> movies = generator.generate(n);
+    benchSerialization(n, movies);
+    benchDatabase(n, movies);
+    benchNetwork(n, movies);
+}
+
+void MovieBench::benchSerialization(int n, const QVector<Movie>& movies) {
+    // Per-movie costs don't depend on the collection size, and a million QJsonObjects
+    // would take gigabytes, so these passes cover at most the first 200k movies
+    const int items = qMin(n, 200000);
+    const int iterations = items <= 10000 ? 10 : 3;
+
+    // Inputs for the decoders are built untimed, so each benchmark can run on its own (--filter)
+    QVector<QJsonObject> objects;
+    QVector<QString> lines;
+    objects.reserve(items);
+    lines.reserve(items);
+    for (int i = 0; i < items; ++i) {
+        objects.append(movies[i].toJson());
+        lines.append(movies[i].toCsvString());
+    }
+
+    measure("Movie::toJson", n, iterations, items, [&](int) {
+        for (int i = 0; i < items; ++i) {
+            m_checksum += movies[i].toJson().size();
+        }
+    });
+    measure("Movie::fromJson", n, iterations, items, [&](int) {
+        for (const QJsonObject& object : objects) {
+            m_checksum += Movie::fromJson(object).getYear();
+        }
+    });
+    measure("Movie::toCsvString", n, iterations, items, [&](int) {
+        for (int i = 0; i < items; ++i) {
+            m_checksum += movies[i].toCsvString().size();
+        }
+    });
+    measure("Movie::fromCsvString", n, iterations, items, [&](int) {
+        for (const QString& line : lines) {
+            m_checksum += Movie::fromCsvString(line).getYear();
+        }
+    });
+}
+
+void MovieBench::benchDatabase(int n, const QVector<Movie>& movies) {
+    // The database is filled the way the app does it at startup: from a snapshot file
+    QTemporaryDir dir;
+    const QString path = dir.filePath("bench.snapshot");
+    MovieStore store;
+    for (const Movie& movie : movies) {
+        store.append(movie);
+    }
+    QString error;
+    if (!SnapshotFile::write(path, store, 1, &error)) {
+        QTextStream(stderr) << "Cannot write snapshot: " << error << "\n";
+        return;
+    }
+
+    auto* database = new MovieDatabase();
+    database->setSnapshotPath(path);
+    measure("MovieDatabase::loadSnapshot", n, 1, n, [&](int) { database->loadSnapshot(); });
+    if (database->getMovieCount() != n && !database->loadSnapshot()) {
+        QTextStream(stderr) << "Cannot load snapshot\n";
+        delete database;
+        return;
+    }
+
+    // Each search runs a batch of different realistic queries drawn from the generator
+    const int queries = 20;
+    MovieGenerator sampler(m_seed + 1);
+    QStringList titleWords, directors, noteWords;
+    QVector<QDate> fromDates;
+    for (int i = 0; i < queries; ++i) {
+        titleWords.append(sampler.sampleTitleWord());
+        directors.append(sampler.sampleDirector());
+        noteWords.append(sampler.sampleNoteWord() + ' ' + sampler.sampleNoteWord());
+        fromDates.append(MovieGenerator::referenceDate().addDays(-30 * (1 + i * 3)));
+    }
+
+    measure("MovieDatabase::searchByName", n, queries, 1, [&](int i) {
+        m_checksum += database->searchByName(titleWords[i]).size();
+    });
+    measure("MovieDatabase::searchByDirector", n, queries, 1, [&](int i) {
+        m_checksum += database->searchByDirector(directors[i]).size();
+    });
+    measure("MovieDatabase::searchByDateRange", n, queries, 1, [&](int i) {
+        m_checksum += database->searchByDateRange(fromDates[i], fromDates[i].addDays(30)).size();
+    });
+    measure("MovieDatabase::getFavorites", n, 5, 1, [&](int) {
+        m_checksum += database->getFavorites().size();
+    });
+    measure("MovieDatabase::query", n, queries, 1, [&](int i) {
+        MovieQuery query;
+        query.nameContains = titleWords[i];
+        query.addedFrom = fromDates[i];
+        query.addedTo = MovieGenerator::referenceDate();
+        m_checksum += database->query(query).size();
+    });
+    measure("MovieDatabase::fuzzyQuery", n, queries, 1, [&](int i) {
+        // One transposed letter pair, the typo a user most often makes
+        QString typo = titleWords[i];
+        if (typo.size() > 3) {
+            std::swap(typo[1], typo[2]);
+        }
+        MovieQuery query;
+        query.nameContains = typo;
+        m_checksum += database->fuzzyQuery(query).size();
+    });
+    measure("MovieDatabase::textQuery", n, queries, 1, [&](int i) {
+        m_checksum += database->textQuery(noteWords[i], MovieQuery()).size();
+    });
+
+    benchWindow(n, database);
+}
+
+void MovieBench::benchWindow(int n, MovieDatabase* database) {
+    MainWindow window(database); // owns the database from here on
+    window.show();
+    QCoreApplication::processEvents();
+
+    const QVector<int> all = database->allRows();
+    for (int index = 0; index < window.m_sortByCombo->count(); ++index) {
+        {
+            const QSignalBlocker blocker(window.m_sortByCombo); // no table refresh on change
+            window.m_sortByCombo->setCurrentIndex(index);
+        }
+        const QString order = window.m_sortByCombo->itemData(index).toString();
+        measure(QString("MainWindow::applySorting[%1]").arg(order), n, 5, n, [&](int) {
+            QVector<int> rows = all;
+            window.applySorting(rows);
+            m_checksum += rows.isEmpty() ? 0 : rows.first();
+        });
+    }
+
+    // Setting the view plus the layout and paint of the visible rows it triggers
+    measure("MainWindow::updateMovieTable", n, 5, n, [&](int) {
+        window.updateMovieTable(all);
+        QCoreApplication::processEvents();
+    });
+}
+
+void MovieBench::benchNetwork(int n, const QVector<Movie>& movies) {
+    // The server answers from a JSON or CBOR document built per page; past 100k movies
+    // that is only slower, not different, so larger collections skip these
+    if (n > 100000) {
+        return;
+    }
+    // The server runs on this thread: the timings include its encoding, like a
+    // backend on the same machine would
+    MockMovieServer server;
+    server.setOptions(m_network);
+    server.setMovies(movies);
+    if (!server.listen()) {
+        QTextStream(stderr) << "Cannot start the mock server: " << server.errorString() << "\n";
+        return;
+    }
+    const int iterations = n <= 10000 ? 5 : 2;
+
+    MovieDatabase database(server.baseUrl());
+    database.setPreferCbor(false);
+    measure("MovieDatabase::loadFromApi[json]", n, iterations, n, [&](int) {
+        m_checksum += database.loadFromApi() ? database.getMovieCount() : 0;
+    });
+    database.setPreferCbor(true);
+    measure("MovieDatabase::loadFromApi[cbor]", n, iterations, n, [&](int) {
+        m_checksum += database.loadFromApi() ? database.getMovieCount() : 0;
+    });
+    // A refresh with nothing new on the server: one small request, no store changes
+    database.syncFromApi();
+    measure("MovieDatabase::syncFromApi[unchanged]", n, 10, 1, [&](int) {
+        m_checksum += database.syncFromApi() ? 1 : 0;
+    });
+}
+
+QJsonObject MovieBench::report() const {
+    QJsonObject root;
+    root["benchmark"] = "movie_bench";
+    root["format"] = 1;
+    root["seed"] = qint64(m_seed);
+    root["started"] = QDateTime::currentDateTimeUtc().toString(Qt::ISODate);
+    root["qt_version"] = QString::fromLatin1(qVersion());
+    root["os"] = QSysInfo::prettyProductName();
+    root["cpu_architecture"] = QSysInfo::currentCpuArchitecture();
+    root["threads"] = QThread::idealThreadCount();
+    root["checksum"] = QString::number(m_checksum);
+    root["results"] = m_results;
+    return root;
+}
+
+int main(int argc, char *argv[])
+{
+    // Widgets are timed without a display
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+    QApplication app(argc, argv);
+    app.setApplicationName("movie_bench");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Times movie serialization, search, sorting and table updates on "
+                                     "generated collections; writes JSON results.");
+    parser.addHelpOption();
+    QCommandLineOption sizesOption("sizes", "Comma-separated collection sizes.", "list", "1000,10000,100000,1000000");
+    QCommandLineOption seedOption("seed", "Generator seed.", "n", "20240601");
+    QCommandLineOption filterOption("filter", "Only benchmarks whose name contains this text.", "text");
+    QCommandLineOption outputOption("output", "Write the JSON here instead of stdout.", "file");
+    QCommandLineOption latencyOption("latency", "Mock API delay before every response, in ms.", "ms", "0");
+    QCommandLineOption bandwidthOption("bandwidth", "Mock API rate limit in KiB/s (0 = unlimited).", "kib", "0");
+    QCommandLineOption traceOption("trace", "Also record trace spans and write them to this Chrome trace file.",
+                                   "file");
+    parser.addOptions({sizesOption, seedOption, filterOption, outputOption, latencyOption, bandwidthOption,
+                       traceOption});
+    parser.process(app);
+
+    QVector<int> sizes;
+    for (const QString& part : parser.value(sizesOption).split(',', Qt::SkipEmptyParts)) {
+        bool ok = false;
+        const int n = part.trimmed().toInt(&ok);
+        if (!ok || n <= 0) {
+            QTextStream(stderr) << "Invalid size: " << part << "\n";
+            return 2;
+        }
+        sizes.append(n);
+    }
+
+    MovieBench bench(parser.value(seedOption).toUInt(), parser.value(filterOption));
+    MockMovieServer::Options network;
+    network.latencyMs = parser.value(latencyOption).toInt();
+    network.bytesPerSecond = parser.value(bandwidthOption).toLongLong() * 1024;
+    bench.setNetwork(network);
+    // Timings then include the recording cost, so compare traced runs only with each other
+    if (parser.isSet(traceOption)) {
+        Trace::start();
+    }
+    for (int n : sizes) {
+        bench.run(n);
+    }
+    if (parser.isSet(traceOption)) {
+        QString error;
+        if (!Trace::stop(parser.value(traceOption), &error)) {
+            QTextStream(stderr) << "Cannot write trace: " << error << "\n";
+        }
+    }
+
+    const QByteArray json = QJsonDocument(bench.report()).toJson(QJsonDocument::Indented);
+    if (parser.isSet(outputOption)) {
+        QFile file(parser.value(outputOption));
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            QTextStream(stderr) << "Cannot write " << file.fileName() << ": " << file.errorString() << "\n";
+            return 1;
+        }
+        file.write(json);
+    } else {
+        QTextStream(stdout) << json;
+    }
+    return 0;
+}
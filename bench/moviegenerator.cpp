@@ -0,0 +1,206 @@
+// ============== MovieGenerator.cpp ==============
+#include "moviegenerator.h"
+#include <cmath>
+
+namespace {
+
+const char* const kTitleWords[] = {
+    "night", "city", "last", "dark", "love", "man", "war", "house", "blood", "girl",
+    "star", "dead", "king", "life", "lost", "world", "time", "secret", "road", "day",
+    "black", "fire", "moon", "story", "heart", "return", "rising", "shadow", "river", "dream",
+    "red", "island", "ghost", "killer", "game", "summer", "winter", "edge", "empire", "garden",
+    "silent", "wild", "blue", "storm", "hunter", "stranger", "mountain", "ocean", "sky", "legend",
+    "broken", "golden", "iron", "glass", "paper", "midnight", "morning", "street", "train", "wolf",
+    "angel", "devil", "queen", "prince", "son", "daughter", "mother", "father", "brother", "sister",
+    "journey", "escape", "revenge", "promise", "memory", "echo", "crown", "kingdom", "machine", "planet",
+    "inception", "horizon", "frontier", "voyage", "harbor", "desert", "forest", "valley", "bridge", "tower",
+    "mirror", "letter", "song", "dance", "circus", "hotel", "station", "cathedral", "prison", "castle",
+};
+
+const char* const kArticles[] = {"The", "A", "Return of the", "Night of the", "Beyond the", "Into the"};
+
+const char* const kFirstNames[] = {
+    "Christopher", "Martin", "Steven", "Kathryn", "Akira", "Sofia", "Quentin", "Greta", "Denis", "Agnes",
+    "Wong", "Bong", "Hayao", "Jane", "Pedro", "Ingmar", "Federico", "Ridley", "James", "Chloe",
+    "Alfonso", "Guillermo", "Park", "Claire", "Spike", "Kelly", "Jordan", "Ava", "Lynne", "Celine",
+    "Andrei", "Satyajit", "Yasujiro", "Michael", "David", "Wes", "Paul", "Joel", "Ethan", "Barry",
+};
+
+const char* const kLastNames[] = {
+    "Nolan", "Scorsese", "Spielberg", "Bigelow", "Kurosawa", "Coppola", "Tarantino", "Gerwig", "Villeneuve", "Varda",
+    "Kar-wai", "Joon-ho", "Miyazaki", "Campion", "Almodovar", "Bergman", "Fellini", "Scott", "Cameron", "Zhao",
+    "Cuaron", "del Toro", "Chan-wook", "Denis", "Lee", "Reichardt", "Peele", "DuVernay", "Ramsay", "Sciamma",
+    "Tarkovsky", "Ray", "Ozu", "Mann", "Lynch", "Anderson", "Thomas", "Fincher", "Jenkins", "Wright",
+};
+
+const char* const kReviewWords[] = {
+    "the", "and", "a", "of", "to", "is", "in", "it", "that", "film",
+    "this", "with", "but", "was", "for", "as", "movie", "on", "its", "not",
+    "story", "one", "an", "at", "by", "so", "are", "good", "great", "more",
+    "his", "her", "all", "very", "from", "performance", "too", "characters", "really", "time",
+    "ending", "scene", "best", "well", "much", "plot", "acting", "feels", "watch", "again",
+    "beautiful", "slow", "first", "cast", "script", "visual", "music", "score", "brilliant", "boring",
+    "director", "camera", "shot", "twist", "pacing", "dialogue", "lead", "world", "emotional", "funny",
+    "dark", "sequel", "original", "remake", "classic", "masterpiece", "overrated", "underrated", "rewatch", "cinematography",
+    "effects", "soundtrack", "tense", "gripping", "predictable", "clever", "moving", "haunting", "stunning", "forgettable",
+    "charming", "violent", "quiet", "ambitious", "messy", "tight", "long", "short", "perfect", "flawed",
+};
+
+// Syllables for invented words; their count fixes the size of the long vocabulary tail
+const char* const kSyllables[] = {
+    "ka", "ri", "mo", "sel", "dar", "vin", "lo", "tha", "quen", "bri",
+    "zor", "el", "am", "nu", "fi", "gra", "tor", "we", "sha", "pel",
+};
+
+template <typename T, size_t N>
+constexpr int countOf(T (&)[N]) { return int(N); }
+
+} // namespace
+
+MovieGenerator::MovieGenerator(quint32 seed) : m_random(seed) {
+    // Review vocabulary: real words first (the frequent head of the Zipf curve), then a
+    // long tail of invented ones so big collections contain millions of words of notes
+    for (const char* word : kReviewWords) {
+        m_vocabulary.append(QString::fromLatin1(word));
+    }
+    const int syllables = countOf(kSyllables);
+    for (int a = 0; a < syllables; ++a) {
+        for (int b = 0; b < syllables; ++b) {
+            for (int c = 0; c < syllables; c += 2) {
+                m_vocabulary.append(QString::fromLatin1(kSyllables[a]) + kSyllables[b] + kSyllables[c]);
+            }
+        }
+    }
+    for (int a = 0; a < syllables; ++a) {
+        for (int b = 0; b < syllables; ++b) {
+            QString word = QString::fromLatin1(kSyllables[a]) + kSyllables[b];
+            word[0] = word[0].toUpper();
+            m_inventedWords.append(word);
+        }
+    }
+    setExpectedCount(1000);
+}
+
+void MovieGenerator::setExpectedCount(int count) {
+    // About eight films per director on average; Zipf picks make that very uneven
+    const int pool = qMax(16, count / 8);
+    const int firsts = countOf(kFirstNames);
+    const int lasts = countOf(kLastNames);
+    m_directors.clear();
+    m_directors.reserve(pool);
+    for (int i = 0; i < pool; ++i) {
+        QString name = QString::fromLatin1(kFirstNames[i % firsts]) + ' ' + kLastNames[(i / firsts + i) % lasts];
+        if (i >= firsts * lasts) {
+            // Unbounded suffix: every pool entry stays a distinct director at any size
+            name += QString(" %1").arg(i / (firsts * lasts));
+        }
+        m_directors.append(name);
+    }
+}
+
+int MovieGenerator::zipf(int n, double s) {
+    // Inverse CDF of the continuous approximation: rank 0 is the most frequent
+    const double u = m_random.generateDouble();
+    const double exponent = 1.0 - s;
+    const double x = std::pow((std::pow(double(n) + 1.0, exponent) - 1.0) * u + 1.0, 1.0 / exponent);
+    return qBound(0, int(x) - 1, n - 1);
+}
+
+QString MovieGenerator::titleWord() {
+    if (m_random.bounded(10) == 0) {
+        return m_inventedWords[m_random.bounded(int(m_inventedWords.size()))];
+    }
+    QString word = QString::fromLatin1(kTitleWords[zipf(countOf(kTitleWords), 0.9)]);
+    word[0] = word[0].toUpper();
+    return word;
+}
+
+QString MovieGenerator::makeName() {
+    if (!m_recentNames.isEmpty() && m_random.bounded(100) == 0) {
+        return m_recentNames[m_random.bounded(int(m_recentNames.size()))]; // remakes and re-releases
+    }
+    QStringList words;
+    if (m_random.bounded(4) == 0) {
+        words.append(QString::fromLatin1(kArticles[m_random.bounded(countOf(kArticles))]));
+    }
+    const int length = 1 + qMin(zipf(6, 1.2), 5);
+    for (int i = 0; i < length; ++i) {
+        words.append(titleWord());
+    }
+    QString name = words.join(' ');
+    const int extra = m_random.bounded(20);
+    if (extra == 0) {
+        name += QString(" %1").arg(2 + m_random.bounded(4));
+    } else if (extra == 1) {
+        name += ": " + titleWord() + ' ' + titleWord();
+    }
+    if (m_recentNames.size() < 256) {
+        m_recentNames.append(name);
+    } else {
+        m_recentNames[m_random.bounded(int(m_recentNames.size()))] = name;
+    }
+    return name;
+}
+
+QString MovieGenerator::makeNotes() {
+    if (m_random.bounded(4) == 0) {
+        return QString();
+    }
+    const int words = 5 + zipf(146, 0.6);
+    QString notes;
+    notes.reserve(words * 7);
+    for (int i = 0; i < words; ++i) {
+        if (i > 0) {
+            notes += (m_random.bounded(12) == 0) ? QStringLiteral(". ") : QStringLiteral(" ");
+        }
+        notes += m_vocabulary[zipf(int(m_vocabulary.size()), 1.07)];
+    }
+    notes += '.';
+    notes[0] = notes[0].toUpper();
+    return notes;
+}
+
+Movie MovieGenerator::next() {
+    // Years: half from the last 25 years, the rest spread back to 1920
+    const int year = m_random.bounded(2) == 0 ? 2000 + m_random.bounded(25) : 1920 + m_random.bounded(105);
+    // One draw per statement: argument evaluation order would make the output compiler-dependent
+    const QString name = makeName();
+    const QString director = m_directors[zipf(int(m_directors.size()), 1.1)];
+    const QString notes = makeNotes();
+    const bool favorite = m_random.bounded(100) < 12;
+    Movie movie(name, year, director, notes, favorite);
+    movie.setDateAdded(referenceDate().addDays(-qint64(m_random.bounded(5 * 365))));
+    return movie;
+}
+
+QVector<Movie> MovieGenerator::generate(int count) {
+    setExpectedCount(count);
+    QVector<Movie> movies;
+    movies.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        movies.append(next());
+    }
+    return movies;
+}
+
+MovieStore MovieGenerator::generateStore(int count) {
+    setExpectedCount(count);
+    MovieStore store;
+    for (int i = 0; i < count; ++i) {
+        store.append(next());
+    }
+    return store;
+}
+
+QString MovieGenerator::sampleTitleWord() {
+    return QString::fromLatin1(kTitleWords[zipf(countOf(kTitleWords), 0.9)]);
+}
+
+QString MovieGenerator::sampleDirector() {
+    const QString name = m_directors[zipf(int(m_directors.size()), 1.1)];
+    return name.section(' ', 1); // without the first name, as a user would type it
+}
+
+QString MovieGenerator::sampleNoteWord() {
+    return m_vocabulary[zipf(int(m_vocabulary.size()), 1.07)];
+}
@@ -0,0 +1,54 @@
+// ============== MovieGenerator.h ==============
+#ifndef MOVIEGENERATOR_H
+#define MOVIEGENERATOR_H
+
+#include "movie.h"
+#include "moviestore.h"
+#include <QRandomGenerator>
+#include <QStringList>
+#include <QVector>
+
+// Deterministic synthetic collections for benchmarks and load tests: the same
+// seed and size always give the same movies.
+//
+// Distributions are meant to look like a real personal collection:
+// - names are 1-6 words from a title vocabulary, sometimes with an article,
+//   a subtitle or a sequel number, and about 1% repeat an earlier name
+// - directors come from a pool of about count/8 names, picked with a Zipf
+//   skew so a few directors have many films and most have one or two
+// - years lean towards recent decades; date added spans the five years before
+//   a fixed reference date
+// - a quarter of the notes are empty; the rest are 5-150 words of review
+//   text with Zipf word frequencies
+// - about 12% are favorites
+class MovieGenerator {
+public:
+    explicit MovieGenerator(quint32 seed = 20240601);
+
+    Movie next();
+    QVector<Movie> generate(int count);
+    MovieStore generateStore(int count);
+
+    // Fixed so generated collections don't depend on the day they are made
+    static QDate referenceDate() { return QDate(2025, 1, 1); }
+
+    // Lookup terms that occur in generated data, for search benchmarks
+    QString sampleTitleWord();
+    QString sampleDirector();
+    QString sampleNoteWord();
+
+private:
+    int zipf(int n, double s);
+    QString titleWord();
+    QString makeName();
+    QString makeNotes();
+    void setExpectedCount(int count);
+
+    QRandomGenerator m_random;
+    QStringList m_vocabulary;    // review words, most frequent first
+    QStringList m_inventedWords; // proper-noun-like words for titles
+    QStringList m_directors;
+    QVector<QString> m_recentNames;
+};
+
+#endif // MOVIEGENERATOR_H
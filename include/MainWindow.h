@@ -11,14 +11,18 @@
 #include <QTextEdit>
 #include <QCheckBox>
 #include <QPushButton>
-#include <QTableWidget>
+#include <QTableView>
 #include <QDateEdit>
 #include <QGroupBox>
 #include <QLabel>
 #include <QStatusBar>
 #include <QSplitter>
 #include <QComboBox>
+#include <QTimer>
+#include <QPointer>
+#include <QDialog>
 #include "moviedatabase.h"
+#include "movietablemodel.h"
 
 class MainWindow : public QMainWindow
 {
@@ -26,23 +30,36 @@ class MainWindow : public QMainWindow
 
 public:
     MainWindow(QWidget *parent = nullptr);
+    // Shows an already populated database and starts no loading or syncing of its
+    // own (benchmarks, tools); takes ownership
+    explicit MainWindow(MovieDatabase* database, QWidget *parent = nullptr);
     ~MainWindow();
 
+private:
+    friend class MovieBench; // times applySorting/updateMovieTable directly
+
 private slots:
     void addMovie();
     void searchMovies();
     void clearSearch();
     void refreshTable();
+    void onMoviesChanged();
+    void onWritesConfirmed();
     void editMovie();
     void deleteMovie();                  
     void onTableDoubleClicked(int row, int column);  
+    void showDiagnostics();
 private:
     void setupUI();
     void setupAddMovieForm();
     void setupSearchPanel();
     void setupMovieTable();
-    void updateMovieTable(const QVector<Movie>& movies);
-    void applySorting(QVector<Movie>& movies) const;
+    void updateMovieTable(const QVector<int>& rows);
+    void applySorting(QVector<int>& rows) const;
+    void currentSort(MovieDatabase::SortKey& key, bool& descending) const;
+    bool isServerSide() const { return m_serverSideCheckBox->isChecked(); }
+    void showRemoteQuery();
+    MovieQuery currentQuery() const;
     void clearAddForm();
     void populateEditForm(const Movie& movie); 
     void showStatusMessage(const QString& message, int timeout = 3000);
@@ -64,23 +81,36 @@ private:
     QGroupBox* m_searchGroup;
     QLineEdit* m_searchNameEdit;
     QLineEdit* m_searchDirectorEdit;
+    QLineEdit* m_searchReviewEdit;
     QDateEdit* m_startDateEdit;
     QDateEdit* m_endDateEdit;
     QCheckBox* m_favoritesOnlyCheckBox;
+    QCheckBox* m_serverSideCheckBox;
+    QCheckBox* m_fuzzyCheckBox;
     QPushButton* m_searchButton;
     QPushButton* m_clearSearchButton;
     
     // Movie Display
-    QTableWidget* m_movieTable;
+    QTableView* m_movieTable;
+    MovieTableModel* m_movieModel;
     QPushButton* m_editButton;        
     QPushButton* m_deleteButton;
+    QPushButton* m_diagnosticsButton;
+    QPointer<QDialog> m_diagnosticsDialog; // open diagnostics window, if any
     QComboBox* m_sortByCombo;
     QLabel* m_statusLabel;
     
     // Data
     MovieDatabase* m_database;
-    QVector<Movie> m_currentMovies; 
-    int m_editingIndex;
+    Movie m_editingMovie;
+    MovieQuery m_remoteQuery; // last search shown in server-side mode
+    // Last local search and its rows; a query that narrows it only filters these rows
+    MovieQuery m_lastQuery;
+    QVector<int> m_lastResults;
+    quint64 m_lastResultsVersion;
+    bool m_hasLastResults;
+    QTimer m_searchDebounce; // search-as-you-type fires once typing pauses
+    bool m_isEditing;
 };
 
 #endif // MAINWINDOW_H
@@ -0,0 +1,32 @@
+// ============== DiagnosticsDialog.h ==============
+#ifndef DIAGNOSTICSDIALOG_H
+#define DIAGNOSTICSDIALOG_H
+
+#include "metrics.h"
+#include <QDialog>
+#include <QTimer>
+
+class QLabel;
+class QTableWidget;
+
+// Live view of a Metrics registry: one row per series with its count or value
+// and, for durations, p50/p95/p99 and the maximum. Refreshes every second while
+// open; the raw Prometheus text can be copied for bug reports.
+class DiagnosticsDialog : public QDialog {
+    Q_OBJECT
+
+public:
+    explicit DiagnosticsDialog(const Metrics& metrics, QWidget* parent = nullptr);
+
+private slots:
+    void refresh();
+    void copyAsText();
+
+private:
+    const Metrics& m_metrics;
+    QTableWidget* m_table;
+    QLabel* m_dumpLabel;
+    QTimer m_refreshTimer;
+};
+
+#endif // DIAGNOSTICSDIALOG_H
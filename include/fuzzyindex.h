@@ -0,0 +1,63 @@
+// ============== FuzzyIndex.h ==============
+#ifndef FUZZYINDEX_H
+#define FUZZYINDEX_H
+
+#include <QHash>
+#include <QString>
+#include <QStringView>
+#include <QVector>
+
+// Typo-tolerant word index over one text field, keyed by row number.
+// Text is split into case-folded words; each distinct word (term) keeps a
+// sorted list of the rows that contain it. Terms are found with symmetric
+// deletes (SymSpell): every string reachable by deleting up to two characters
+// from a term's first PrefixLength characters points back to the term, so a
+// query word only generates its own deletes and looks them up, and the few
+// terms found are verified with a real edit distance. Nothing scans the
+// dictionary.
+class FuzzyIndex {
+public:
+    struct Match {
+        int row;
+        int distance; // summed over the query words
+    };
+
+    static const int MaxDistance = 2;
+    static const int PrefixLength = 7;
+
+    void clear();
+
+    void addRow(int row, QStringView text);
+    void removeRow(int row, QStringView text);
+
+    // Edits a query word of this length may contain and still match: none for
+    // words up to 3 characters, one up to 5, two beyond that
+    static int maxDistanceFor(int length) { return length <= 3 ? 0 : length <= 5 ? 1 : MaxDistance; }
+
+    // Rows in which every query word is within its budget of some word of the
+    // row, in row order. Transposed letters count as one edit.
+    QVector<Match> search(QStringView query) const;
+
+private:
+    struct Term {
+        QString text;
+        QVector<int> rows; // sorted
+    };
+    struct TermMatch {
+        int term;
+        int distance;
+    };
+
+    static QVector<QString> wordsOf(QStringView text);
+    static int deleteDepth(int length);
+    static QVector<quint64> deletesOf(QStringView word, int depth);
+    static int editDistance(QStringView a, QStringView b, int max);
+    QVector<TermMatch> matchWord(const QString& word) const;
+
+    QVector<Term> m_terms;
+    QVector<int> m_freeTerms;           // ids of terms whose last row went away
+    QHash<QString, int> m_termIds;
+    QHash<quint64, QVector<int>> m_deletes; // hash of a delete variant -> term ids
+};
+
+#endif // FUZZYINDEX_H
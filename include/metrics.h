@@ -0,0 +1,140 @@
+// ============== Metrics.h ==============
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QJsonObject>
+#include <QMutex>
+#include <QString>
+#include <QTimer>
+#include <QVector>
+#include <atomic>
+#include <map>
+#include <memory>
+
+// Monotonic count (requests, bytes, errors)
+class MetricCounter {
+public:
+    void add(quint64 amount = 1) { m_value.fetch_add(amount, std::memory_order_relaxed); }
+    quint64 value() const { return m_value.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<quint64> m_value{0};
+};
+
+// Current level (collection size)
+class MetricGauge {
+public:
+    void set(qint64 value) { m_value.store(value, std::memory_order_relaxed); }
+    qint64 value() const { return m_value.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<qint64> m_value{0};
+};
+
+// Durations in fixed buckets from 0.5 ms to 30 s, plus the exact count, sum and
+// maximum. Quantiles are interpolated within a bucket, so they are estimates
+// accurate to the bucket width; the maximum is exact.
+class MetricHistogram {
+public:
+    static const int BucketCount = 15;
+    static const double* bucketBounds(); // upper bounds in seconds, ascending
+
+    void record(qint64 nanoseconds);
+    quint64 count() const { return m_count.load(std::memory_order_relaxed); }
+    double sumSeconds() const { return m_sumNs.load(std::memory_order_relaxed) / 1e9; }
+    double maxSeconds() const { return m_maxNs.load(std::memory_order_relaxed) / 1e9; }
+    quint64 bucket(int index) const { return m_buckets[index].load(std::memory_order_relaxed); } // BucketCount = +Inf
+    double quantile(double q) const; // seconds, 0 when empty
+
+private:
+    std::atomic<quint64> m_buckets[BucketCount + 1] = {};
+    std::atomic<quint64> m_count{0};
+    std::atomic<quint64> m_sumNs{0};
+    std::atomic<quint64> m_maxNs{0};
+};
+
+// Records the lifetime of the scope into a histogram (nothing when it is null)
+class MetricTimer {
+public:
+    explicit MetricTimer(MetricHistogram* histogram) : m_histogram(histogram) { m_timer.start(); }
+    ~MetricTimer() {
+        if (m_histogram) {
+            m_histogram->record(m_timer.nsecsElapsed());
+        }
+    }
+    MetricTimer(const MetricTimer&) = delete;
+    MetricTimer& operator=(const MetricTimer&) = delete;
+
+private:
+    MetricHistogram* m_histogram;
+    QElapsedTimer m_timer;
+};
+
+// Registry of named series, exported in the Prometheus text format or as JSON.
+//
+// Recording is lock-free: counters, gauges and histogram buckets are relaxed
+// atomics, so any thread may record. Only looking a series up takes a mutex;
+// hot paths look theirs up once and keep the pointer, which stays valid for the
+// registry's lifetime. Labels are passed preformatted, e.g.
+// label("endpoint", "GET /movies"); the same name and labels give the same series.
+class Metrics {
+public:
+    enum Kind { Counter, Gauge, Histogram };
+
+    // One series as shown in the diagnostics view; durations in seconds
+    struct Sample {
+        QString name;
+        QString labels;
+        Kind kind;
+        double value; // counter or gauge value, histogram count
+        double sum;
+        double p50;
+        double p95;
+        double p99;
+        double max;
+    };
+
+    Metrics();
+    ~Metrics();
+
+    static QString label(const QString& key, const QString& value);
+    static QString labels(const QString& first, const QString& second) { return first + ',' + second; }
+    void describe(const QString& name, const QString& help); // # HELP line of a metric family
+
+    MetricCounter* counter(const QString& name, const QString& labels = QString());
+    MetricGauge* gauge(const QString& name, const QString& labels = QString());
+    MetricHistogram* histogram(const QString& name, const QString& labels = QString());
+
+    QVector<Sample> samples() const;
+    QByteArray toPrometheus() const;
+    QJsonObject toJson() const;
+    // JSON for a .json path, the Prometheus text format otherwise; replaced atomically
+    bool writeTo(const QString& path, QString* error = nullptr) const;
+
+    // Rewrites path every intervalMs, and once more when stopped or destroyed
+    void startDump(const QString& path, int intervalMs);
+    void stopDump();
+    QString dumpPath() const { return m_dumpPath; }
+
+private:
+    struct Series {
+        Kind kind;
+        QString name;
+        QString labels;
+        std::unique_ptr<MetricCounter> counter;
+        std::unique_ptr<MetricGauge> gauge;
+        std::unique_ptr<MetricHistogram> histogram;
+    };
+    Series& series(Kind kind, const QString& name, const QString& labels);
+
+    mutable QMutex m_mutex;
+    std::map<QString, Series> m_series; // by name{labels}, so exports group families
+    QHash<QString, QString> m_help;
+    QTimer m_dumpTimer;
+    QString m_dumpPath;
+};
+
+#endif // METRICS_H
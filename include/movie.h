@@ -6,6 +6,9 @@
 #include <QDate>
 #include <QJsonObject>
 
+class QCborStreamReader;
+class QCborStreamWriter;
+
 class Movie {
 public:
     Movie();
@@ -19,6 +22,7 @@ public:
     QString getDirector() const { return m_director; }
     QString getNotes() const { return m_notes; }
     bool isFavorite() const { return m_isFavorite; }
+    qint64 getId() const { return m_id; } // Backend row id, 0 when not yet persisted
     
     // Setters
     void setName(const QString& name) { m_name = name; }
@@ -27,6 +31,7 @@ public:
     void setNotes(const QString& notes) { m_notes = notes; }
     void setFavorite(bool favorite) { m_isFavorite = favorite; }
     void setDateAdded(const QDate& date) { m_dateAdded = date; }
+    void setId(qint64 id) { m_id = id; }
     
     // CSV conversion
     QString toCsvString() const;
@@ -35,6 +40,13 @@ public:
     // JSON conversion for API
     QJsonObject toJson() const;
     static Movie fromJson(const QJsonObject& obj);
+
+    // CBOR record for bulk API traffic: a positional array
+    // [id, name, year, director, date_added, notes, is_favorite] with date_added
+    // as days since 1970-01-01 (null when unset). Keys are not repeated per row.
+    void toCbor(QCborStreamWriter& writer) const;
+    // Reads one record; on malformed input reader.lastError() is set
+    static Movie fromCbor(QCborStreamReader& reader);
     
 private:
     QString m_name;
@@ -43,6 +55,7 @@ private:
     QString m_director;
     QString m_notes;
     bool m_isFavorite;
+    qint64 m_id;
 };
 
 #endif // MOVIE_H
@@ -0,0 +1,53 @@
+// ============== MovieCsv.h ==============
+#ifndef MOVIECSV_H
+#define MOVIECSV_H
+
+#include "movie.h"
+#include "moviestore.h"
+#include <QByteArray>
+#include <QSaveFile>
+#include <QString>
+#include <QStringView>
+
+// RFC 4180 reader and writer for movie dumps in the data/movies.csv format:
+//   Movie Name,Year,Director,Date Added,Notes,Is Favorite
+// Quoted fields may contain commas, doubled quotes and line breaks. The legacy
+// five-column layout without Director is still read. A header row is optional;
+// when present, its column names decide the layout (the names the Python
+// importer accepts work too).
+class MovieCsv {
+public:
+    // Reads a whole file into the store. The file is memory-mapped, and large
+    // files are cut into chunks at record boundaries and parsed on all cores.
+    static bool readFile(const QString& path, MovieStore& out, QString* error = nullptr);
+    // Same for CSV text already in memory
+    static bool parse(const char* data, qsizetype size, MovieStore& out, QString* error = nullptr);
+    // Parses a single record (no header detection); false if it has fewer than five fields
+    static bool parseRecord(const QByteArray& record, Movie& movie);
+
+    static QByteArray header();
+    // One record without the line terminator
+    static void appendRecord(QByteArray& out, const Movie& movie);
+    static void appendRecord(QByteArray& out, const MovieStore& store, int row);
+
+    // Streams records to a file through a fixed-size buffer; the file replaces
+    // the old one only when commit() succeeds.
+    class Writer {
+    public:
+        explicit Writer(const QString& path);
+        bool open(bool withHeader = true);
+        void write(const Movie& movie);
+        void write(const MovieStore& store, int row);
+        bool commit();
+        QString errorString() const { return m_file.errorString(); }
+
+    private:
+        void flushIfFull();
+
+        QSaveFile m_file;
+        QByteArray m_buffer;
+        bool m_failed = false;
+    };
+};
+
+#endif // MOVIECSV_H
@@ -1,48 +1,316 @@
-
 // ============== MovieDatabase.h ==============
 #ifndef MOVIEDATABASE_H
 #define MOVIEDATABASE_H
 
 #include "movie.h"
+#include "moviequery.h"
+#include "moviestore.h"
+#include "movieview.h"
+#include "fuzzyindex.h"
+#include "metrics.h"
+#include "textindex.h"
+#include "trigramindex.h"
+#include "writejournal.h"
+#include <QObject>
 #include <QVector>
+#include <QHash>
+#include <QBitArray>
+#include <QJsonObject>
 #include <QString>
+#include <QCollator>
 #include <QNetworkAccessManager>
 #include <QNetworkReply>
+#include <QThreadPool>
+#include <QTimer>
+#include <atomic>
+#include <functional>
+#include <memory>
+
+class MovieDatabase : public QObject {
+    Q_OBJECT
 
-class MovieDatabase {
 public:
-    MovieDatabase(const QString& apiBaseUrl = "http://127.0.0.1:8000");
+    enum SortKey { SortByDateAdded, SortByName, SortByYear };
+
+    // Called on the owning thread once a request has finished
+    using Completion = std::function<void(bool ok, const QString& error)>;
+
+    explicit MovieDatabase(const QString& apiBaseUrl = "http://127.0.0.1:8000", QObject* parent = nullptr);
+    ~MovieDatabase() override;
     
-    // Core operations
+    // Asynchronous operations: return immediately, any number may be in flight.
+    // Loads and syncs are serialized: a call made while one is running completes
+    // with it (a full load asked for during a sync runs after that sync).
+    void loadFromApiAsync(Completion done = {});
+    void syncFromApiAsync(Completion done = {});
+    void addMovieAsync(const Movie& movie, Completion done = {});
+    void updateMovieAsync(const Movie& original, const Movie& updatedMovie, Completion done = {});
+    void deleteMovieAsync(const Movie& movie, Completion done = {});
+    void waitUntilReadyAsync(int timeoutMs = 10000, Completion done = {});
+
+    // Server-side query mode: one page of the filtered, sorted result. Does not touch
+    // the in-memory collection. Pass the returned cursor to get the next page; it is
+    // empty on the last page.
+    using PageCompletion = std::function<void(bool ok, const QString& error, const MovieStore& page,
+                                              const QString& nextCursor)>;
+    void fetchPageAsync(const MovieQuery& query, SortKey key, bool descending, const QString& cursor,
+                        int limit, PageCompletion done);
+
+    // Blocking wrappers around the async operations (for scripts and simple callers)
     bool loadFromApi();
+    bool syncFromApi(); // Delta sync from the last known revision; full load on first call
     bool addMovie(const Movie& movie);
     bool updateMovie(const Movie& original, const Movie& updatedMovie);
     bool deleteMovie(const Movie& movie);
     bool waitUntilReady(int timeoutMs = 10000);
+
+    // Local snapshot cache: the last synced collection and its revision, rewritten
+    // in the background after every sync that changed something. Empty path = off.
+    void setSnapshotPath(const QString& path) { m_snapshotPath = path; }
+    QString getSnapshotPath() const { return m_snapshotPath; }
+    // Restores the cached collection; the next syncFromApi() is then a delta from its revision
+    bool loadSnapshot();
+    static QString defaultSnapshotPath(const QString& apiBaseUrl); // per backend, in AppLocalDataLocation
+
+    // Ask for CBOR instead of JSON on bulk reads (load and sync); off by default.
+    // Falls back to JSON transparently when the server answers with JSON.
+    void setPreferCbor(bool prefer) { m_preferCbor = prefer; }
+    bool prefersCbor() const { return m_preferCbor; }
+
+    // Write coalescing: with a window > 0, add/update/delete are queued and sent
+    // together through POST /movies/batch once the window (started by the first
+    // queued write) expires or maxBatch writes are waiting. Each write's completion
+    // still gets its own result. Off (window 0) by default. maxBatch is capped at
+    // 1000, the most operations the backend accepts in one batch.
+    void setWriteCoalescing(int windowMs, int maxBatch = 50);
+    int queuedWrites() const { return m_writeQueue.size(); }
+
+    // Optimistic mode: add/update/delete change the local collection at once and
+    // complete immediately. Each write is first appended to an fsync'd journal and
+    // then replayed to the backend in order, retrying while it is unreachable.
+    // Entries still in the journal at startup are re-applied and replayed.
+    // A write the backend rejects (409, 404, ...) is dropped, reported through
+    // writeRejected() and the collection is reloaded from the server.
+    bool enableOptimisticWrites(const QString& journalPath);
+    bool isOptimistic() const { return m_journal.isOpen(); }
+    int unconfirmedWrites() const { return m_journal.pending().size(); }
+    static QString defaultJournalPath(const QString& apiBaseUrl);
     
     // Search functions
-    QVector<Movie> getAllMovies() const { return m_movies; }
+    QVector<Movie> getAllMovies() const;
     QVector<Movie> searchByName(const QString& name) const;
     QVector<Movie> searchByDirector(const QString& director) const;
     QVector<Movie> searchByDateRange(const QDate& startDate, const QDate& endDate) const;
     QVector<Movie> getFavorites() const;
+
+    // Evaluates every predicate of the query in one pass; returns matching rows
+    QVector<int> query(const MovieQuery& query) const;
+    // Same result without blocking: large scans are split into chunks on a thread
+    // pool over a snapshot of the rows and merged in order. done runs on this
+    // object's thread. Starting another queryAsync (or cancelScans) supersedes a
+    // running one, whose workers stop early and whose done is never called.
+    using QueryCompletion = std::function<void(const QVector<int>& rows)>;
+    void queryAsync(const MovieQuery& query, QueryCompletion done);
+    // queryAsync restricted to rows, e.g. the result of a query this one narrows
+    // (see MovieQuery::narrows). rows must come from the current storeVersion().
+    void refineAsync(const QVector<int>& rows, const MovieQuery& query, QueryCompletion done);
+    void cancelScans();
+    // Typo-tolerant variant of query(): name and director match word by word within
+    // an edit budget that grows with word length ("Incpetion", "Nolen"). The other
+    // predicates apply as usual. Rows come ranked by total edit distance, closest first.
+    QVector<int> fuzzyQuery(const MovieQuery& query) const;
+    // Full-text search over notes and names: rows containing any of the words,
+    // best BM25 score first, at most limit of them. The filters' predicates must
+    // hold as in query().
+    QVector<int> textQuery(const QString& text, const MovieQuery& filters, int limit = 1000) const;
+    // Bumped on every change to the rows; row numbers from an older version may be stale
+    quint64 storeVersion() const { return m_storeVersion; }
+    // Row of a movie with the same case-insensitive name and year, or -1
+    int findDuplicate(const QString& name, int year) const;
+
+    // Index-backed lookups returning row numbers (valid until the next change)
+    QVector<int> findByName(const QString& name) const;
+    QVector<int> findByDirector(const QString& director) const;
+    Movie movieAt(int row) const { return m_store.movie(row); }
+    QVector<Movie> moviesAt(const QVector<int>& rows) const;
+    QVector<int> allRows() const;
+
+    // Column access for scans; views into the store are valid until the next change
+    const MovieStore& store() const { return m_store; }
+
+    // Zero-copy access: a snapshot shares the current rows until the next change.
+    // moviesAboutToChange() asks holders to let go before that change copies them.
+    MovieSnapshot snapshot() const {
+        m_storeShared = true;
+        return MovieSnapshot(m_store);
+    }
+    MovieView view(const QVector<int>& rows) const { return MovieView(snapshot(), rows); }
+
+    // Ordering from the maintained sort indexes (names use precomputed collation keys)
+    QVector<int> sortedRows(SortKey key, bool descending = false) const;
+    QVector<int> sortRows(const QVector<int>& rows, SortKey key, bool descending = false) const;
     
     // Utility
-    int getMovieCount() const { return m_movies.size(); }
+    int getMovieCount() const { return m_store.size(); }
     QString getLastError() const { return m_lastError; }
     QString getApiBaseUrl() const { return m_apiBaseUrl; }
+    qint64 getRevision() const { return m_revision; }
+    int pendingRequests() const { return m_pendingRequests; }
+
+    // Request latency by endpoint, operation latency (addMovie, loadFromApi, ...),
+    // bytes, network errors, collection size and search/sort times. Recording is
+    // lock-free; metrics().startDump() writes them to a file periodically.
+    Metrics& metrics() { return m_metrics; }
+    const Metrics& metrics() const { return m_metrics; }
+
+public slots:
+    // Sends any queued writes now
+    void flushWrites();
+
+signals:
+    // Emitted whenever the in-memory collection changed (load, sync or a confirmed write)
+    void moviesChanged();
+    // Emitted before the first change to the rows after snapshot() was called. Holders
+    // that can drop their snapshot should, or the change copies every column; the
+    // moviesChanged() that follows hands out the new rows.
+    void moviesAboutToChange();
+    // The backend accepted writes made through this object (after the local
+    // change in optimistic mode); views of server-side queries refresh on this
+    void writesConfirmed();
+    // An optimistic write was refused by the backend and has been undone
+    void writeRejected(const Movie& movie, const QString& error);
     
 private:
-    QVector<Movie> m_movies;
+    class QueryMatcher;
+
+    MovieStore m_store;
+    quint64 m_storeVersion = 0;
+    mutable bool m_storeShared = false; // a snapshot was handed out since the last moviesAboutToChange
+    QHash<qint64, int> m_rowById; // backend id -> row in m_store
+    // Hashes of the exact (name, year, date_added) identity and of the
+    // case-folded (name, year) duplicate key; hits are confirmed against the store
+    QMultiHash<size_t, int> m_rowsByIdentity;
+    QMultiHash<size_t, int> m_rowsByDuplicateKey;
+    TrigramIndex m_nameIndex;
+    TrigramIndex m_directorIndex;
+    FuzzyIndex m_fuzzyNameIndex;
+    FuzzyIndex m_fuzzyDirectorIndex;
+    TextIndex m_textIndex; // notes and names, BM25
+    QCollator m_collator;
+    QVector<QCollatorSortKey> m_nameKeys; // one per row
+    QVector<int> m_byDateAdded;           // rows in ascending order, ties by row
+    QVector<int> m_byName;
+    QVector<int> m_byYear;
+    qint64 m_revision;            // change cursor of the last load/sync, -1 = never loaded
     QString m_apiBaseUrl;
+    QString m_snapshotPath;
+    bool m_preferCbor;
     QNetworkAccessManager m_network;
     QString m_lastError;
+    int m_pendingRequests;
+
+    struct PendingWrite {
+        enum Kind { Create, Update, Delete };
+        Kind kind;
+        Movie original; // identity of the row for update/delete
+        Movie movie;    // new values for create/update
+        Completion done;
+    };
+    QVector<PendingWrite> m_writeQueue;
+    QTimer m_flushTimer;
+    int m_coalesceWindowMs;
+    int m_coalesceMaxBatch;
+    WriteJournal m_journal;
+    QTimer m_replayTimer;
+    int m_replayBackoffMs;
+    bool m_replaying;
+    bool m_replayBatches; // off once the backend turned out not to take /movies/batch
+    // Outcome of one replayed entry: HTTP status, the server's copy on success, the reason otherwise
+    struct ReplayResult {
+        int status;
+        QJsonObject movie;
+        QString error;
+    };
+    // At most one load/sync in flight; later callers wait for it (see refreshAsync)
+    bool m_refreshing;
+    bool m_refreshIsLoad;
+    QVector<Completion> m_refreshWaiters;
+    QVector<Completion> m_queuedLoadWaiters;
+    quint64 m_confirmedWrites; // bumped for every write the server confirmed
+    QThreadPool m_scanPool;
+    std::shared_ptr<std::atomic<quint64>> m_scanGeneration = std::make_shared<std::atomic<quint64>>(0);
+    Metrics m_metrics;
+    // Series recorded on hot paths, looked up once
+    MetricCounter* m_bytesSent;
+    MetricCounter* m_bytesReceived;
+    MetricGauge* m_collectionSize;
+    MetricHistogram* m_queryDuration;
+    MetricHistogram* m_scanDuration;
+    MetricHistogram* m_fuzzyQueryDuration;
+    MetricHistogram* m_textQueryDuration;
+    MetricHistogram* m_sortDuration;
     
     void clearError() { m_lastError.clear(); }
     void setError(const QString& error) { m_lastError = error; }
-};
-
-#endif // MOVIEDATABASE_H
 
+    QNetworkRequest jsonRequest(const QString& path) const;
+    QNetworkRequest readRequest(const QString& path) const; // jsonRequest plus format negotiation
+    void onReply(QNetworkReply* reply, std::function<void(QNetworkReply*)> handler);
+    void complete(const Completion& done, bool ok, const QString& error = QString());
+    // Wraps done so the operation's duration and failure are recorded when it completes
+    Completion timed(const QString& operation, Completion done);
+    bool runBlocking(const std::function<void(Completion)>& start);
+    // GET of a movie list in either wire format; error is empty on success
+    using ListHandler = std::function<void(QNetworkReply* reply, const MovieStore& movies, const QString& error)>;
+    void fetchMovieListAsync(const QString& path, ListHandler handler);
+    void refreshAsync(bool fullLoad, Completion done);
+    void refreshLoad();
+    // Changes since a revision, applied on top of base (a loaded list held back) when given
+    void refreshChanges(qint64 since, std::shared_ptr<const MovieStore> base);
+    void finishRefresh(bool ok, const QString& error = QString());
 
+    // All changes to m_store go through these so lookup tables stay in sync
+    void resetRows(const QVector<Movie>& movies);
+    void resetStore(const MovieStore& store);
+    void insertRow(const Movie& movie);
+    void replaceRow(int row, const Movie& movie);
+    void removeRow(int row);
+    void releaseSnapshots();
+    void indexRow(int row);
+    void indexLookups(int row);
+    void unindexRow(int row);
+    int findRow(const Movie& movie) const;
+    static size_t identityHash(QStringView name, int year, qint32 day);
+    static size_t duplicateHash(QStringView name, int year);
+    void upsertById(const Movie& movie);
+    bool applyUpdated(const Movie& original, const Movie& updated);
+    bool applyDeleted(const Movie& movie);
+    // One request per write, no journal or queue; done is called as given (not timed again)
+    void sendCreate(const Movie& movie, const Completion& done);
+    void sendUpdate(const Movie& original, const Movie& movie, const Completion& done);
+    void sendDelete(const Movie& movie, const Completion& done);
+    void enqueueWrite(const PendingWrite& write);
+    void writeOptimistically(WriteJournal::Entry entry, const Completion& done);
+    bool applyJournalEntry(const WriteJournal::Entry& entry);
+    bool reapplyJournal();
+    void replayJournal();
+    void retryReplay();
+    void confirmReplay(const QVector<WriteJournal::Entry>& entries, QVector<ReplayResult> results, int from);
+    void finishReplay(const QVector<WriteJournal::Entry>& entries, const QVector<ReplayResult>& results);
+    static QJsonObject identityKey(const Movie& movie);
+    static QJsonObject createBody(const Movie& movie);
+    static QJsonObject batchOperation(WriteJournal::Op op, const Movie& original, const Movie& movie);
+    void saveSnapshotAsync() const;
+    bool rowLess(SortKey key, int a, int b) const;
+    const QVector<int>& sortIndex(SortKey key) const;
+    QVector<int>& sortIndex(SortKey key);
+    void sortIndexInsert(int row);
+    void sortIndexErase(int row);
+    QVector<int> queryCandidates(const MovieQuery& query, bool& seeded) const;
+    void scanAsync(const MovieQuery& query, const QVector<int>& candidates, bool seeded, QueryCompletion done);
+    QVector<int> rowsAddedBetween(const QDate& from, const QDate& to) const;
+    QVector<int> findBySubstring(const TrigramIndex& index, QStringView (MovieStore::*field)(int) const,
+                                 const QString& query) const;
+};
 
+#endif // MOVIEDATABASE_H
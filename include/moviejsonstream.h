@@ -0,0 +1,46 @@
+// ============== MovieJsonStream.h ==============
+#ifndef MOVIEJSONSTREAM_H
+#define MOVIEJSONSTREAM_H
+
+#include "moviestore.h"
+#include <QByteArray>
+#include <QString>
+
+// Incremental decoder for the JSON array returned by GET /movies.
+//
+// feed() takes the body in whatever chunks the network delivers. Each object
+// is decoded as soon as its closing brace arrives, straight from the bytes into
+// the store, so only the unfinished tail of the body is ever buffered and no
+// QJsonDocument is built.
+class MovieJsonStream {
+public:
+    MovieJsonStream();
+
+    // Returns false once the input is known to be malformed
+    bool feed(const QByteArray& chunk);
+    // Call after the last chunk; false if the array was incomplete or malformed
+    bool finish();
+
+    bool hasError() const { return m_state == Error; }
+    QString errorString() const { return m_error; }
+    int movieCount() const { return m_store.size(); }
+    MovieStore takeStore();
+
+private:
+    enum State { BeforeArray, InArray, InObject, AfterArray, Error };
+
+    void fail(const QString& error);
+    bool decodeObject(const char* begin, const char* end);
+
+    State m_state;
+    QByteArray m_buffer;    // bytes not yet consumed
+    qsizetype m_scanPos;    // next byte of m_buffer to look at
+    qsizetype m_objectStart;
+    int m_depth;
+    bool m_inString;
+    bool m_escaped;
+    MovieStore m_store;
+    QString m_error;
+};
+
+#endif // MOVIEJSONSTREAM_H
@@ -0,0 +1,43 @@
+// ============== MovieQuery.h ==============
+#ifndef MOVIEQUERY_H
+#define MOVIEQUERY_H
+
+#include "movie.h"
+#include <QString>
+#include <QDate>
+
+// All search predicates at once, so MovieDatabase::query can pick the most
+// selective index to start from and check the rest in a single pass.
+// Empty strings and null dates mean "no constraint".
+struct MovieQuery {
+    QString nameContains;
+    QString directorContains;
+    QDate addedFrom;
+    QDate addedTo;
+    bool favoritesOnly = false;
+
+    bool hasDateRange() const { return addedFrom.isValid() || addedTo.isValid(); }
+
+    // True when every movie matching this query also matches previous, so this
+    // query's results can be found by filtering previous's results
+    // ("incep" -> "incept", a narrower date range, favorites switched on)
+    bool narrows(const MovieQuery& previous) const {
+        if (previous.favoritesOnly && !favoritesOnly) return false;
+        if (previous.addedFrom.isValid() && !(addedFrom.isValid() && addedFrom >= previous.addedFrom)) return false;
+        if (previous.addedTo.isValid() && !(addedTo.isValid() && addedTo <= previous.addedTo)) return false;
+        if (!nameContains.contains(previous.nameContains, Qt::CaseInsensitive)) return false;
+        return directorContains.contains(previous.directorContains, Qt::CaseInsensitive);
+    }
+
+    // Full predicate check, cheapest tests first
+    bool matches(const Movie& movie) const {
+        if (favoritesOnly && !movie.isFavorite()) return false;
+        if (addedFrom.isValid() && movie.getDateAdded() < addedFrom) return false;
+        if (addedTo.isValid() && movie.getDateAdded() > addedTo) return false;
+        if (!directorContains.isEmpty() && !movie.getDirector().contains(directorContains, Qt::CaseInsensitive)) return false;
+        if (!nameContains.isEmpty() && !movie.getName().contains(nameContains, Qt::CaseInsensitive)) return false;
+        return true;
+    }
+};
+
+#endif // MOVIEQUERY_H
@@ -0,0 +1,87 @@
+// ============== MovieStore.h ==============
+#ifndef MOVIESTORE_H
+#define MOVIESTORE_H
+
+#include "movie.h"
+#include <QBitArray>
+#include <QHash>
+#include <QString>
+#include <QStringList>
+#include <QStringView>
+#include <QVector>
+#include <limits>
+
+// Column-oriented storage for the movie collection.
+//
+// Year, date and favorite live in dense columns that can be scanned without
+// touching any string data. Directors are interned into a dictionary, and names
+// and notes are packed into one shared text arena. All members are implicitly
+// shared Qt containers, so copying a store is cheap and copy-on-write.
+//
+// QStringViews returned by name()/notes()/director() are valid until the next
+// change to the store. Use movie() to get an independent Movie value.
+class MovieStore {
+public:
+    int size() const { return m_years.size(); }
+    bool isEmpty() const { return m_years.isEmpty(); }
+    void clear();
+    void reserve(int rows);
+
+    void append(const Movie& movie);
+    // Appends all rows of another store (column-wise, no Movie values in between)
+    void append(const MovieStore& other);
+    void set(int row, const Movie& movie);
+    // Removes a row by moving the last row into its place
+    void removeRow(int row);
+
+    // Materializes one row as a Movie value
+    Movie movie(int row) const;
+
+    QStringView name(int row) const { return textAt(m_nameOffsets[row], m_nameLengths[row]); }
+    QStringView notes(int row) const { return textAt(m_notesOffsets[row], m_notesLengths[row]); }
+    QStringView director(int row) const { return m_directorNames[m_directorOf[row]]; }
+    int directorId(int row) const { return m_directorOf[row]; }
+    int year(int row) const { return m_years[row]; }
+    qint32 day(int row) const { return m_days[row]; }
+    QDate dateAdded(int row) const { return m_days[row] == NoDay ? QDate() : QDate::fromJulianDay(m_days[row]); }
+    bool isFavorite(int row) const { return m_favorites.testBit(row); }
+    qint64 id(int row) const { return m_ids[row]; }
+
+    // Dense columns for scans
+    const QVector<qint16>& years() const { return m_years; }
+    const QVector<qint32>& days() const { return m_days; }
+    const QBitArray& favorites() const { return m_favorites; }
+    int favoriteCount() const { return m_favoriteCount; }
+
+    // Interned director names; ids are stable for the lifetime of the store
+    const QStringList& directorNames() const { return m_directorNames; }
+
+    // Day number used in the date column; invalid dates sort first
+    static constexpr qint32 NoDay = std::numeric_limits<qint32>::min();
+    static qint32 dayNumber(const QDate& date) { return date.isValid() ? qint32(date.toJulianDay()) : NoDay; }
+
+private:
+    friend class SnapshotFile;
+
+    QStringView textAt(qint32 offset, qint32 length) const { return QStringView(m_text).mid(offset, length); }
+    qint32 appendText(const QString& text);
+    int internDirector(const QString& director);
+    void compactText();
+
+    QString m_text;                 // names and notes, back to back
+    qint64 m_deadText = 0;          // arena characters no longer referenced by any row
+    QVector<qint32> m_nameOffsets;
+    QVector<qint32> m_nameLengths;
+    QVector<qint32> m_notesOffsets;
+    QVector<qint32> m_notesLengths;
+    QVector<qint32> m_directorOf;
+    QStringList m_directorNames;
+    QHash<QString, int> m_directorIds;
+    QVector<qint16> m_years;
+    QVector<qint32> m_days;         // Julian day numbers
+    QBitArray m_favorites;
+    int m_favoriteCount = 0;
+    QVector<qint64> m_ids;
+};
+
+#endif // MOVIESTORE_H
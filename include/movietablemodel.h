@@ -0,0 +1,69 @@
+// ============== MovieTableModel.h ==============
+#ifndef MOVIETABLEMODEL_H
+#define MOVIETABLEMODEL_H
+
+#include "moviedatabase.h"
+#include "moviequery.h"
+#include "movieview.h"
+#include <QAbstractTableModel>
+#include <QVector>
+
+// Read-only table model over a MovieView. Cell text is produced in data()
+// only for the rows the view actually paints, so refreshing a large list costs
+// one model reset instead of an item per cell.
+//
+// In remote mode (setRemoteQuery) the rows come from the server instead, one
+// page at a time as the view scrolls, through canFetchMore()/fetchMore(). Only
+// the pages fetched so far are held in memory.
+class MovieTableModel : public QAbstractTableModel
+{
+    Q_OBJECT
+
+public:
+    enum Column { NameColumn, YearColumn, DirectorColumn, DateAddedColumn, NotesColumn, FavoriteColumn, ColumnCount };
+
+    explicit MovieTableModel(QObject* parent = nullptr);
+
+    // Replaces the displayed movies (shares the snapshot, no copies)
+    void setView(const MovieView& view);
+    const MovieView& view() const { return m_view; }
+    // Drops the local view's rows (and its share of the database's store) until the
+    // next setView(); remote pages are kept
+    void releaseView();
+
+    // Switches to remote mode and starts over from the first page; setView() leaves it
+    void setRemoteQuery(MovieDatabase* database, const MovieQuery& query, MovieDatabase::SortKey key, bool descending);
+    bool isRemote() const { return m_database != nullptr; }
+    // Movie shown at a view row, taking header sorting into account
+    Movie movieAt(int row) const { return m_view.at(m_order[row]); }
+
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex& parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+    void sort(int column, Qt::SortOrder order = Qt::AscendingOrder) override;
+    bool canFetchMore(const QModelIndex& parent) const override;
+    void fetchMore(const QModelIndex& parent) override;
+
+signals:
+    void fetchFailed(const QString& error);
+
+private:
+    void appendPage(const MovieStore& page, const QString& nextCursor);
+
+    MovieView m_view;
+    QVector<int> m_order; // view row -> index in m_view
+
+    // Remote mode
+    MovieDatabase* m_database = nullptr;
+    MovieQuery m_remoteQuery;
+    MovieDatabase::SortKey m_remoteKey = MovieDatabase::SortByDateAdded;
+    bool m_remoteDescending = true;
+    MovieStore m_pages;         // every row fetched so far; m_view is over a snapshot of it
+    QString m_nextCursor;
+    bool m_hasMore = false;
+    bool m_fetching = false;
+    quint64 m_generation = 0;   // bumped on every reset so late pages of an old query are dropped
+};
+
+#endif // MOVIETABLEMODEL_H
@@ -0,0 +1,46 @@
+// ============== MovieView.h ==============
+#ifndef MOVIEVIEW_H
+#define MOVIEVIEW_H
+
+#include "moviestore.h"
+#include <QVector>
+
+// Immutable copy-on-write image of the movie store. Taking one only bumps a
+// reference count; the store detaches on its next write, so a snapshot keeps
+// seeing the rows as they were when it was taken.
+class MovieSnapshot {
+public:
+    MovieSnapshot() = default;
+    explicit MovieSnapshot(const MovieStore& store) : m_store(store) {}
+
+    int size() const { return m_store.size(); }
+    bool isEmpty() const { return m_store.isEmpty(); }
+    Movie at(int row) const { return m_store.movie(row); }
+    // Column access without materializing a Movie
+    const MovieStore& store() const { return m_store; }
+
+private:
+    MovieStore m_store;
+};
+
+// A selection of snapshot rows in a given order, e.g. a search result sorted
+// for display. Holds row numbers, never copies of the movies.
+class MovieView {
+public:
+    MovieView() = default;
+    MovieView(const MovieSnapshot& snapshot, const QVector<int>& rows)
+        : m_snapshot(snapshot), m_rows(rows) {}
+
+    int size() const { return m_rows.size(); }
+    bool isEmpty() const { return m_rows.isEmpty(); }
+    Movie at(int index) const { return m_snapshot.at(m_rows.at(index)); }
+    int rowAt(int index) const { return m_rows.at(index); }
+    const QVector<int>& rows() const { return m_rows; }
+    const MovieSnapshot& snapshot() const { return m_snapshot; }
+
+private:
+    MovieSnapshot m_snapshot;
+    QVector<int> m_rows;
+};
+
+#endif // MOVIEVIEW_H
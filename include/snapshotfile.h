@@ -0,0 +1,20 @@
+// ============== SnapshotFile.h ==============
+#ifndef SNAPSHOTFILE_H
+#define SNAPSHOTFILE_H
+
+#include "moviestore.h"
+#include <QString>
+
+// On-disk image of a MovieStore plus the sync revision it corresponds to.
+//
+// Layout: a fixed header (magic, format version, byte-order mark, counts,
+// revision, payload size and FNV-1a checksum) followed by the store's columns
+// as raw arrays, each 8-byte aligned. Reading maps the file and copies the
+// columns straight into the store, so no per-row parsing happens.
+class SnapshotFile {
+public:
+    static bool write(const QString& path, const MovieStore& store, qint64 revision, QString* error = nullptr);
+    static bool read(const QString& path, MovieStore& store, qint64& revision, QString* error = nullptr);
+};
+
+#endif // SNAPSHOTFILE_H
@@ -0,0 +1,61 @@
+// ============== TextIndex.h ==============
+#ifndef TEXTINDEX_H
+#define TEXTINDEX_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QString>
+#include <QStringView>
+#include <QVector>
+#include <functional>
+
+// Full-text inverted index over the review notes and names, keyed by row
+// number and ranked with BM25. Words are case-folded runs of letters and
+// digits; a name word counts NameWeight times so a title hit outranks a
+// passing mention in a review. Each posting list is a run of blocks of up to
+// a few hundred rows, each a byte string of varint-coded (row delta, term
+// frequency) pairs in row order: a common word costs a byte or two per row,
+// and adding or removing a row inside the list rewrites only its block.
+class TextIndex {
+public:
+    struct Hit {
+        int row;
+        float score;
+    };
+
+    static const int NameWeight = 2;
+
+    void clear();
+
+    void addRow(int row, QStringView name, QStringView notes);
+    void removeRow(int row, QStringView name, QStringView notes);
+
+    // Best-scoring rows for the query words (any word may match), highest score
+    // first, ties by row. Rows rejected by accept are skipped before the limit applies.
+    QVector<Hit> search(QStringView query, int limit, const std::function<bool(int)>& accept = {}) const;
+
+private:
+    struct Block {
+        QByteArray data; // varint (row - previous row, tf) pairs; the first delta counts from -1
+        int rows = 0;
+        int lastRow = -1;
+    };
+    struct Posting {
+        QVector<Block> blocks; // ascending, non-overlapping row ranges
+        int rows = 0;
+    };
+
+    static QHash<QString, int> termFrequencies(QStringView name, QStringView notes, int& length);
+    static void appendVarint(QByteArray& out, quint32 value);
+    static quint32 readVarint(const char*& p);
+    static void decode(const Block& block, QVector<int>& rows, QVector<int>& tfs);
+    static void encode(Block& block, const QVector<int>& rows, const QVector<int>& tfs, int from, int to);
+    static QVector<Block>::iterator findBlock(Posting& posting, int row); // first block ending at or after row
+
+    QHash<QString, Posting> m_postings;
+    QVector<quint32> m_lengths; // weighted word count per row, 0 for rows not indexed
+    qint64 m_totalLength = 0;
+    int m_documents = 0;
+};
+
+#endif // TEXTINDEX_H
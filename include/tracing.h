@@ -0,0 +1,68 @@
+// ============== Tracing.h ==============
+#ifndef TRACING_H
+#define TRACING_H
+
+#include <QString>
+#include <atomic>
+
+// Process-wide recorder of timed spans, exported as Chrome Trace Event JSON
+// (open in https://ui.perfetto.dev or chrome://tracing).
+//
+// Recording is off until start() is called. While it is off, a span costs one
+// relaxed atomic load and nothing is allocated, so instrumentation stays in
+// release builds. Span and argument names must be string literals: only the
+// pointers are stored.
+//
+// Spans are complete events on the thread that ran them. Work that starts on
+// one callback and ends on another (a network request, an async query) uses
+// asyncBegin/asyncEnd with an id from nextAsyncId().
+class Trace {
+public:
+    static bool isEnabled() { return s_enabled.load(std::memory_order_relaxed); }
+
+    // Clears earlier events and starts recording; timestamps are relative to this call
+    static void start();
+    // Stops recording and writes everything recorded to path
+    static bool stop(const QString& path, QString* error = nullptr);
+
+    // Nanoseconds since start()
+    static qint64 now();
+    static void complete(const char* name, qint64 startNs, const char* argName = nullptr, qint64 argValue = 0);
+    static quint64 nextAsyncId();
+    static void asyncBegin(const char* name, quint64 id, const QString& detail = QString());
+    static void asyncEnd(const char* name, quint64 id, const char* argName = nullptr, qint64 argValue = 0);
+
+private:
+    static inline std::atomic<bool> s_enabled{false};
+};
+
+// Records the enclosing scope as one span; setArg() attaches a number (rows, bytes)
+class TraceSpan {
+public:
+    explicit TraceSpan(const char* name)
+        : m_name(Trace::isEnabled() ? name : nullptr), m_start(m_name ? Trace::now() : 0) {}
+    ~TraceSpan() {
+        if (m_name) {
+            Trace::complete(m_name, m_start, m_argName, m_argValue);
+        }
+    }
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+
+    void setArg(const char* name, qint64 value) {
+        m_argName = name;
+        m_argValue = value;
+    }
+
+private:
+    const char* m_name;
+    qint64 m_start;
+    const char* m_argName = nullptr;
+    qint64 m_argValue = 0;
+};
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+#define TRACE_SCOPE(name) TraceSpan TRACE_CONCAT(traceSpan_, __LINE__)(name)
+
+#endif // TRACING_H
@@ -0,0 +1,32 @@
+// ============== TrigramIndex.h ==============
+#ifndef TRIGRAMINDEX_H
+#define TRIGRAMINDEX_H
+
+#include <QHash>
+#include <QString>
+#include <QStringView>
+#include <QVector>
+
+// Case-folded trigram index over one text field, keyed by row number.
+// Posting lists are kept sorted so a query intersects them and only the
+// surviving rows need a real substring check.
+class TrigramIndex {
+public:
+    void clear() { m_postings.clear(); }
+    void reserve(int rows) { m_postings.reserve(rows); }
+
+    void addRow(int row, QStringView text);
+    void removeRow(int row, QStringView text);
+
+    // True when the query is long enough for trigram lookups to apply
+    static bool canSearch(QStringView query) { return query.size() >= 3; }
+    // Sorted rows that contain every trigram of the query (a superset of the matches)
+    QVector<int> candidates(QStringView query) const;
+
+private:
+    static QVector<quint64> trigramsOf(QStringView text);
+
+    QHash<quint64, QVector<int>> m_postings;
+};
+
+#endif // TRIGRAMINDEX_H
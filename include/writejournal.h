@@ -0,0 +1,48 @@
+// ============== WriteJournal.h ==============
+#ifndef WRITEJOURNAL_H
+#define WRITEJOURNAL_H
+
+#include "movie.h"
+#include <QFile>
+#include <QString>
+#include <QVector>
+
+// Append-only, fsync'd log of writes that were applied locally but not yet
+// confirmed by the backend. One JSON object per line: entries carry a sequence
+// number, acknowledgements ({"ack": seq}) retire every entry up to that number.
+// A torn last line (crash mid-append) is dropped when the journal is reopened.
+class WriteJournal {
+public:
+    enum Op { Create, Update, Delete };
+
+    struct Entry {
+        qint64 seq = 0;
+        Op op = Create;
+        Movie original; // identity of the row for update/delete
+        Movie movie;    // new values for create/update
+    };
+
+    // Loads unacknowledged entries and rewrites the file to just those
+    bool open(const QString& path, QString* error = nullptr);
+    void close();
+    bool isOpen() const { return m_file.isOpen(); }
+
+    // Assigns the entry's sequence number; the entry is on disk when this returns true
+    bool append(Entry& entry, QString* error = nullptr);
+    // Retires all entries up to and including seq
+    bool acknowledge(qint64 seq, QString* error = nullptr);
+
+    const QVector<Entry>& pending() const { return m_pending; }
+    bool isEmpty() const { return m_pending.isEmpty(); }
+
+private:
+    bool writeDurably(const QByteArray& line, QString* error);
+    static QByteArray encode(const Entry& entry);
+    static bool decode(const QByteArray& line, Entry& entry, qint64& ack);
+
+    QFile m_file;
+    QVector<Entry> m_pending;
+    qint64 m_nextSeq = 1;
+};
+
+#endif // WRITEJOURNAL_H
@@ -0,0 +1,49 @@
+// ============== main.cpp (mock API server) ==============
+// Serves a generated collection through MockMovieServer, so the desktop app or
+// scripts can run against a backend with controlled network conditions.
+//
+//   mock_api_server --port 8000 --movies 100000 --latency 80 --jitter 40 --bandwidth 2048 --error-rate 0.02
+#include "mockmovieserver.h"
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QTextStream>
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    app.setApplicationName("mock_api_server");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("In-memory stand-in for the MovieReviewApp API with injected latency, "
+                                     "bandwidth limits and failures.");
+    parser.addHelpOption();
+    QCommandLineOption portOption("port", "Port to listen on (0 = any free port).", "port", "8000");
+    QCommandLineOption moviesOption("movies", "Number of generated movies.", "n", "1000");
+    QCommandLineOption seedOption("seed", "Seed for the collection and the injected failures.", "n", "20240601");
+    QCommandLineOption latencyOption("latency", "Delay before every response, in ms.", "ms", "0");
+    QCommandLineOption jitterOption("jitter", "Extra random delay of up to this many ms.", "ms", "0");
+    QCommandLineOption bandwidthOption("bandwidth", "Response rate limit in KiB/s (0 = unlimited).", "kib", "0");
+    QCommandLineOption errorRateOption("error-rate", "Fraction of requests answered with 503.", "rate", "0");
+    QCommandLineOption timeoutRateOption("timeout-rate", "Fraction of requests never answered.", "rate", "0");
+    parser.addOptions({portOption, moviesOption, seedOption, latencyOption, jitterOption, bandwidthOption,
+                       errorRateOption, timeoutRateOption});
+    parser.process(app);
+
+    MockMovieServer::Options options;
+    options.latencyMs = parser.value(latencyOption).toInt();
+    options.jitterMs = parser.value(jitterOption).toInt();
+    options.bytesPerSecond = parser.value(bandwidthOption).toLongLong() * 1024;
+    options.errorRate = parser.value(errorRateOption).toDouble();
+    options.timeoutRate = parser.value(timeoutRateOption).toDouble();
+    options.seed = parser.value(seedOption).toUInt();
+
+    MockMovieServer server;
+    server.setOptions(options);
+    server.seed(parser.value(moviesOption).toInt(), options.seed);
+    if (!server.listen(QHostAddress::LocalHost, quint16(parser.value(portOption).toUInt()))) {
+        QTextStream(stderr) << "Cannot listen: " << server.errorString() << "\n";
+        return 1;
+    }
+    QTextStream(stdout) << "Mock API with " << server.movieCount() << " movies at " << server.baseUrl() << "\n";
+    return app.exec();
+}
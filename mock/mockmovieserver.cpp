@@ -0,0 +1,758 @@
+// ============== MockMovieServer.cpp ==============
+#include "mockmovieserver.h"
+#include "moviegenerator.h"
+#include <QCborStreamWriter>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QPointer>
+#include <QTcpSocket>
+#include <QTimer>
+#include <QUrl>
+#include <QUrlQuery>
+#include <algorithm>
+
+namespace {
+
+const int kMaxLimit = 1000;                         // GET /movies limit, as Query(le=1000)
+const int kMaxBatch = 1000;                         // BatchRequest.operations max_length
+const qsizetype kMaxRequestBytes = 64 * 1024 * 1024;
+const int kPaceIntervalMs = 10;                     // bandwidth cap granularity
+
+const char* reasonPhrase(int status) {
+    switch (status) {
+    case 200: return "OK";
+    case 400: return "Bad Request";
+    case 404: return "Not Found";
+    case 405: return "Method Not Allowed";
+    case 409: return "Conflict";
+    case 413: return "Payload Too Large";
+    case 422: return "Unprocessable Entity";
+    case 503: return "Service Unavailable";
+    default: return "Error";
+    }
+}
+
+// Sort keys of GET /movies, as SORT_ORDERS in backend/app.py; ties go by id in the same direction
+enum class SortColumn { Date, Name, Year };
+struct SortOrder {
+    const char* key;
+    SortColumn column;
+    bool descending;
+};
+const SortOrder kSortOrders[] = {
+    {"date_desc", SortColumn::Date, true}, {"date_asc", SortColumn::Date, false},
+    {"name_asc", SortColumn::Name, false}, {"name_desc", SortColumn::Name, true},
+    {"year_desc", SortColumn::Year, true}, {"year_asc", SortColumn::Year, false},
+};
+
+// Names sort lower-cased, like func.lower(Movie.name)
+struct SortValue {
+    qint64 number = 0;
+    QString text;
+};
+
+SortValue sortValue(const Movie& movie, SortColumn column) {
+    SortValue value;
+    switch (column) {
+    case SortColumn::Date: value.number = movie.getDateAdded().toJulianDay(); break;
+    case SortColumn::Year: value.number = movie.getYear(); break;
+    case SortColumn::Name: value.text = movie.getName().toLower(); break; // the backend's lower() folds Unicode too
+    }
+    return value;
+}
+
+int compareValues(const SortValue& a, const SortValue& b, SortColumn column) {
+    if (column == SortColumn::Name) {
+        return a.text.compare(b.text);
+    }
+    return a.number < b.number ? -1 : a.number > b.number ? 1 : 0;
+}
+
+QJsonValue cursorValue(const SortValue& value, SortColumn column) {
+    switch (column) {
+    case SortColumn::Date: return QDate::fromJulianDay(value.number).toString(Qt::ISODate);
+    case SortColumn::Year: return value.number;
+    case SortColumn::Name: return value.text;
+    }
+    return QJsonValue();
+}
+
+// Opaque to clients; the same shape as encode_cursor: base64url of [value, id] without padding
+QString encodeCursor(const SortValue& value, SortColumn column, qint64 id) {
+    const QByteArray raw = QJsonDocument(QJsonArray{cursorValue(value, column), id}).toJson(QJsonDocument::Compact);
+    return QString::fromLatin1(raw.toBase64(QByteArray::Base64UrlEncoding | QByteArray::OmitTrailingEquals));
+}
+
+bool decodeCursor(const QString& cursor, SortColumn column, SortValue& value, qint64& id) {
+    const auto decoded = QByteArray::fromBase64Encoding(
+        cursor.toLatin1(), QByteArray::Base64UrlEncoding | QByteArray::AbortOnBase64DecodingErrors);
+    if (!decoded) {
+        return false;
+    }
+    const QJsonArray array = QJsonDocument::fromJson(*decoded).array();
+    if (array.size() != 2 || !array[1].isDouble()) {
+        return false;
+    }
+    id = array[1].toInteger();
+    switch (column) {
+    case SortColumn::Date: {
+        const QDate date = QDate::fromString(array[0].toString(), Qt::ISODate);
+        value.number = date.toJulianDay();
+        return date.isValid();
+    }
+    case SortColumn::Year:
+        value.number = array[0].toInteger();
+        return array[0].isDouble();
+    case SortColumn::Name:
+        value.text = array[0].toString();
+        return array[0].isString();
+    }
+    return false;
+}
+
+bool queryFlag(const QString& value) {
+    const QString v = value.toLower();
+    return v == "true" || v == "1" || v == "yes" || v == "on";
+}
+
+} // namespace
+
+MockMovieServer::MockMovieServer(QObject* parent) : QObject(parent), m_random(m_options.seed) {
+    connect(&m_server, &QTcpServer::newConnection, this, &MockMovieServer::onNewConnection);
+}
+
+MockMovieServer::~MockMovieServer() {
+    close();
+}
+
+bool MockMovieServer::listen(const QHostAddress& address, quint16 port) {
+    return m_server.listen(address, port);
+}
+
+void MockMovieServer::close() {
+    m_server.close();
+    for (Connection* connection : std::as_const(m_connections)) {
+        connection->pacer->stop();
+        connection->socket->disconnect(this);
+        connection->socket->abort();
+        connection->socket->deleteLater();
+        delete connection;
+    }
+    m_connections.clear();
+}
+
+QString MockMovieServer::baseUrl() const {
+    QHostAddress address = m_server.serverAddress();
+    if (address == QHostAddress::Any || address == QHostAddress::AnyIPv4 || address == QHostAddress::AnyIPv6) {
+        address = QHostAddress::LocalHost;
+    }
+    const QString host = address.protocol() == QAbstractSocket::IPv6Protocol
+        ? "[" + address.toString() + "]" : address.toString();
+    return QString("http://%1:%2").arg(host).arg(m_server.serverPort());
+}
+
+void MockMovieServer::setOptions(const Options& options) {
+    m_options = options;
+    m_random.seed(options.seed);
+}
+
+void MockMovieServer::seed(int count, quint32 seed) {
+    MovieGenerator generator(seed);
+    setMovies(generator.generate(count));
+}
+
+void MockMovieServer::setMovies(const QVector<Movie>& movies) {
+    m_rows.clear();
+    m_byIdentity.clear();
+    m_byDuplicateKey.clear();
+    m_tombstones.clear();
+    m_revision = 0;
+    m_nextId = 1;
+    for (const Movie& source : movies) {
+        Row row;
+        row.movie = source;
+        row.movie.setId(m_nextId++);
+        row.revision = ++m_revision;
+        m_rows.insert(row.movie.getId(), row);
+        indexRow(row.movie.getId());
+    }
+}
+
+QVector<Movie> MockMovieServer::movies() const {
+    QVector<Movie> result;
+    result.reserve(m_rows.size());
+    for (const Row& row : m_rows) {
+        result.append(row.movie);
+    }
+    return result;
+}
+
+// ---- Connections
+
+void MockMovieServer::onNewConnection() {
+    while (QTcpSocket* socket = m_server.nextPendingConnection()) {
+        auto* connection = new Connection;
+        connection->socket = socket;
+        connection->pacer = new QTimer(socket);
+        connection->pacer->setInterval(kPaceIntervalMs);
+        m_connections.insert(socket, connection);
+        connect(connection->pacer, &QTimer::timeout, this, [this, connection]() { pace(connection); });
+        connect(socket, &QTcpSocket::readyRead, this, [this, connection]() {
+            connection->inbox += connection->socket->readAll();
+            processInbox(connection);
+        });
+        connect(socket, &QTcpSocket::disconnected, this, [this, socket]() {
+            if (Connection* connection = m_connections.take(socket)) {
+                connection->pacer->stop();
+                delete connection;
+            }
+            socket->deleteLater();
+        });
+    }
+}
+
+bool MockMovieServer::takeRequest(QByteArray& inbox, Request& request, bool& malformed) {
+    malformed = false;
+    const qsizetype headerEnd = inbox.indexOf("\r\n\r\n");
+    if (headerEnd < 0) {
+        malformed = inbox.size() > 64 * 1024;
+        return false;
+    }
+    const QList<QByteArray> lines = inbox.left(headerEnd).split('\n');
+    const QList<QByteArray> requestLine = lines.first().trimmed().split(' ');
+    if (requestLine.size() != 3) {
+        malformed = true;
+        return false;
+    }
+    request.method = requestLine[0];
+    request.target = requestLine[1];
+    request.headers.clear();
+    for (qsizetype i = 1; i < lines.size(); ++i) {
+        const qsizetype colon = lines[i].indexOf(':');
+        if (colon > 0) {
+            request.headers.insert(lines[i].left(colon).trimmed().toLower(), lines[i].mid(colon + 1).trimmed());
+        }
+    }
+    // QNetworkAccessManager always sends Content-Length; chunked uploads are not supported
+    bool ok = true;
+    const QByteArray lengthHeader = request.headers.value("content-length", "0");
+    const qint64 length = lengthHeader.toLongLong(&ok);
+    if (!ok || length < 0 || length > kMaxRequestBytes || request.headers.contains("transfer-encoding")) {
+        malformed = true;
+        return false;
+    }
+    if (inbox.size() < headerEnd + 4 + length) {
+        return false;
+    }
+    request.body = inbox.mid(headerEnd + 4, length);
+    inbox.remove(0, headerEnd + 4 + length);
+    return true;
+}
+
+void MockMovieServer::processInbox(Connection* connection) {
+    if (connection->busy || connection->hung) {
+        return; // answered strictly in order, one at a time
+    }
+    Request request;
+    bool malformed = false;
+    if (!takeRequest(connection->inbox, request, malformed)) {
+        if (malformed) {
+            connection->busy = true;
+            connection->closeAfter = true;
+            connection->inbox.clear();
+            send(connection, error(400, "Malformed request"));
+        }
+        return;
+    }
+    connection->busy = true;
+    connection->closeAfter = request.headers.value("connection").toLower() == "close";
+    ++m_requests;
+
+    // Failures are drawn when the request arrives; latency applies to every answer
+    const double roll = m_random.generateDouble();
+    if (roll < m_options.timeoutRate) {
+        ++m_timeoutsInjected;
+        connection->hung = true;
+        emit requestHandled(QString::fromLatin1(request.method), QString::fromUtf8(request.target), 0);
+        return;
+    }
+    const bool fail = roll < m_options.timeoutRate + m_options.errorRate;
+    const int delay = m_options.latencyMs + (m_options.jitterMs > 0 ? int(m_random.bounded(m_options.jitterMs + 1)) : 0);
+    QPointer<QTcpSocket> socket = connection->socket;
+    QTimer::singleShot(delay, this, [this, socket, request, fail]() {
+        Connection* connection = socket ? m_connections.value(socket) : nullptr;
+        if (!connection) {
+            return; // the client gave up first
+        }
+        if (fail) {
+            ++m_errorsInjected;
+            send(connection, error(503, "Injected failure"));
+            emit requestHandled(QString::fromLatin1(request.method), QString::fromUtf8(request.target), 503);
+            return;
+        }
+        respond(connection, request);
+    });
+}
+
+void MockMovieServer::respond(Connection* connection, const Request& request) {
+    const Response response = handle(request);
+    send(connection, response);
+    emit requestHandled(QString::fromLatin1(request.method), QString::fromUtf8(request.target), response.status);
+}
+
+void MockMovieServer::send(Connection* connection, const Response& response) {
+    QByteArray bytes = "HTTP/1.1 " + QByteArray::number(response.status) + ' ' + reasonPhrase(response.status) + "\r\n";
+    bytes += "Content-Type: " + response.contentType + "\r\n";
+    bytes += "Content-Length: " + QByteArray::number(response.body.size()) + "\r\n";
+    for (const auto& header : response.headers) {
+        bytes += header.first + ": " + header.second + "\r\n";
+    }
+    bytes += connection->closeAfter ? "Connection: close\r\n\r\n" : "Connection: keep-alive\r\n\r\n";
+    bytes += response.body;
+    m_bytesSent += bytes.size();
+
+    if (m_options.bytesPerSecond <= 0) {
+        connection->socket->write(bytes);
+        finishResponse(connection);
+        return;
+    }
+    connection->outbox = bytes;
+    connection->pacer->start();
+    pace(connection);
+}
+
+void MockMovieServer::pace(Connection* connection) {
+    // A slice per tick, so a large body arrives spread over time as on a slow link
+    const qint64 slice = qMax<qint64>(1, m_options.bytesPerSecond * kPaceIntervalMs / 1000);
+    connection->socket->write(connection->outbox.left(slice));
+    connection->outbox.remove(0, qMin<qint64>(slice, connection->outbox.size()));
+    if (connection->outbox.isEmpty()) {
+        connection->pacer->stop();
+        finishResponse(connection);
+    }
+}
+
+void MockMovieServer::finishResponse(Connection* connection) {
+    connection->busy = false;
+    if (connection->closeAfter) {
+        connection->socket->disconnectFromHost();
+        return;
+    }
+    processInbox(connection);
+}
+
+// ---- Routing
+
+MockMovieServer::Response MockMovieServer::handle(const Request& request) {
+    const qsizetype mark = request.target.indexOf('?');
+    const QByteArray path = mark < 0 ? request.target : request.target.left(mark);
+    QByteArray rawQuery = mark < 0 ? QByteArray() : request.target.mid(mark + 1);
+    rawQuery.replace('+', "%20"); // form encoding, as Starlette reads it
+    const QUrlQuery query(QString::fromUtf8(rawQuery));
+    const bool cbor = request.headers.value("accept").contains("application/cbor");
+
+    auto bodyObject = [&request](bool& ok) {
+        QJsonParseError parseError;
+        const QJsonDocument doc = QJsonDocument::fromJson(request.body, &parseError);
+        ok = parseError.error == QJsonParseError::NoError && doc.isObject();
+        return doc.object();
+    };
+    bool ok = false;
+
+    if (path == "/movies") {
+        if (request.method == "GET") {
+            return listMovies(query, cbor);
+        }
+        if (request.method == "POST" || request.method == "PUT") {
+            const QJsonObject body = bodyObject(ok);
+            if (!ok) {
+                return error(422, "Request body must be a JSON object");
+            }
+            return request.method == "POST" ? createMovie(body) : updateMovie(body);
+        }
+        return error(405, "Method Not Allowed");
+    }
+    if (path == "/movies/changes") {
+        return request.method == "GET" ? listChanges(query, cbor) : error(405, "Method Not Allowed");
+    }
+    if (path == "/movies/delete" || path == "/movies/batch") {
+        if (request.method != "POST") {
+            return error(405, "Method Not Allowed");
+        }
+        const QJsonObject body = bodyObject(ok);
+        if (!ok) {
+            return error(422, "Request body must be a JSON object");
+        }
+        return path == "/movies/delete" ? deleteMovie(body) : batchWrite(body);
+    }
+    return error(404, "Not Found");
+}
+
+MockMovieServer::Response MockMovieServer::json(int status, const QJsonValue& value) {
+    Response response;
+    response.status = status;
+    response.body = value.isArray() ? QJsonDocument(value.toArray()).toJson(QJsonDocument::Compact)
+                                    : QJsonDocument(value.toObject()).toJson(QJsonDocument::Compact);
+    return response;
+}
+
+MockMovieServer::Response MockMovieServer::error(int status, const QString& detail) {
+    return json(status, QJsonObject{{"detail", detail}});
+}
+
+// ---- Reads
+
+MockMovieServer::Response MockMovieServer::listMovies(const QUrlQuery& query, bool cbor) {
+    const QString sortKey = query.hasQueryItem("sort") ? query.queryItemValue("sort", QUrl::FullyDecoded)
+                                                       : QStringLiteral("date_desc");
+    const SortOrder* order = nullptr;
+    for (const SortOrder& candidate : kSortOrders) {
+        if (sortKey == QLatin1String(candidate.key)) {
+            order = &candidate;
+        }
+    }
+    if (!order) {
+        return error(400, "Unknown sort key: " + sortKey);
+    }
+    int limit = -1;
+    if (query.hasQueryItem("limit")) {
+        bool ok = false;
+        limit = query.queryItemValue("limit").toInt(&ok);
+        if (!ok || limit < 1 || limit > kMaxLimit) {
+            return error(422, QString("limit must be between 1 and %1").arg(kMaxLimit));
+        }
+    }
+    QDate addedFrom;
+    QDate addedTo;
+    for (const auto& [key, date] : {std::make_pair(QStringLiteral("added_from"), &addedFrom),
+                                    std::make_pair(QStringLiteral("added_to"), &addedTo)}) {
+        if (query.hasQueryItem(key)) {
+            *date = QDate::fromString(query.queryItemValue(key, QUrl::FullyDecoded), Qt::ISODate);
+            if (!date->isValid()) {
+                return error(422, "Invalid date for " + key);
+            }
+        }
+    }
+    const QString name = query.queryItemValue("name", QUrl::FullyDecoded);
+    const QString director = query.queryItemValue("director", QUrl::FullyDecoded);
+    const bool favoritesOnly = queryFlag(query.queryItemValue("favorites"));
+    const QString after = query.queryItemValue("after", QUrl::FullyDecoded);
+    SortValue afterValue;
+    qint64 afterId = 0;
+    if (!after.isEmpty() && !decodeCursor(after, order->column, afterValue, afterId)) {
+        return error(400, "Invalid cursor");
+    }
+
+    struct Entry {
+        const Movie* movie;
+        SortValue value;
+    };
+    const SortColumn column = order->column;
+    const bool descending = order->descending;
+    // Negative when a comes first in the requested order
+    auto compare = [column, descending](const SortValue& av, qint64 aid, const SortValue& bv, qint64 bid) {
+        int c = compareValues(av, bv, column);
+        if (c == 0) {
+            c = aid < bid ? -1 : aid > bid ? 1 : 0;
+        }
+        return descending ? -c : c;
+    };
+
+    QVector<Entry> entries;
+    for (const Row& row : m_rows) {
+        const Movie& movie = row.movie;
+        if (!name.isEmpty() && !movie.getName().contains(name, Qt::CaseInsensitive)) continue;
+        if (!director.isEmpty() && !movie.getDirector().contains(director, Qt::CaseInsensitive)) continue;
+        if (addedFrom.isValid() && movie.getDateAdded() < addedFrom) continue;
+        if (addedTo.isValid() && movie.getDateAdded() > addedTo) continue;
+        if (favoritesOnly && !movie.isFavorite()) continue;
+        Entry entry{&movie, sortValue(movie, column)};
+        if (!after.isEmpty() && compare(entry.value, movie.getId(), afterValue, afterId) <= 0) continue;
+        entries.append(entry);
+    }
+    auto less = [&compare](const Entry& a, const Entry& b) {
+        return compare(a.value, a.movie->getId(), b.value, b.movie->getId()) < 0;
+    };
+
+    Response response;
+    response.headers.append(qMakePair(QByteArray("X-Movies-Revision"), QByteArray::number(m_revision)));
+    response.headers.append(qMakePair(QByteArray("Vary"), QByteArray("Accept")));
+    if (limit > 0 && entries.size() > limit) {
+        // Only the page (and the row that proves there is a next one) needs ordering
+        std::partial_sort(entries.begin(), entries.begin() + limit, entries.end(), less);
+        entries.resize(limit);
+        const Entry& last = entries.last();
+        const QString cursor = encodeCursor(last.value, column, last.movie->getId());
+        response.headers.append(qMakePair(QByteArray("X-Next-Cursor"), cursor.toLatin1()));
+    } else {
+        std::sort(entries.begin(), entries.end(), less);
+    }
+
+    if (cbor) {
+        // Positional records, as to_cbor_record / Movie::fromCbor
+        QCborStreamWriter writer(&response.body);
+        writer.startArray(entries.size());
+        for (const Entry& entry : entries) {
+            entry.movie->toCbor(writer);
+        }
+        writer.endArray();
+        response.contentType = "application/cbor";
+        return response;
+    }
+    QJsonArray array;
+    for (const Entry& entry : entries) {
+        array.append(entry.movie->toJson());
+    }
+    response.body = QJsonDocument(array).toJson(QJsonDocument::Compact);
+    return response;
+}
+
+MockMovieServer::Response MockMovieServer::listChanges(const QUrlQuery& query, bool cbor) {
+    qint64 since = 0;
+    if (query.hasQueryItem("since")) {
+        bool ok = false;
+        since = query.queryItemValue("since").toLongLong(&ok);
+        if (!ok) {
+            return error(422, "since must be an integer");
+        }
+    }
+    QVector<const Row*> upserts;
+    for (const Row& row : m_rows) {
+        if (row.revision > since) {
+            upserts.append(&row);
+        }
+    }
+    std::sort(upserts.begin(), upserts.end(), [](const Row* a, const Row* b) { return a->revision < b->revision; });
+    QVector<qint64> deletes;
+    for (const auto& tombstone : m_tombstones) {
+        if (tombstone.second > since) {
+            deletes.append(tombstone.first);
+        }
+    }
+
+    Response response;
+    response.headers.append(qMakePair(QByteArray("Vary"), QByteArray("Accept")));
+    if (cbor) {
+        QCborStreamWriter writer(&response.body);
+        writer.startMap(3);
+        writer.append(QLatin1String("revision"));
+        writer.append(m_revision);
+        writer.append(QLatin1String("upserts"));
+        writer.startArray(upserts.size());
+        for (const Row* row : upserts) {
+            row->movie.toCbor(writer);
+        }
+        writer.endArray();
+        writer.append(QLatin1String("deletes"));
+        writer.startArray(deletes.size());
+        for (qint64 id : deletes) {
+            writer.append(id);
+        }
+        writer.endArray();
+        writer.endMap();
+        response.contentType = "application/cbor";
+        return response;
+    }
+    QJsonArray upsertArray;
+    for (const Row* row : upserts) {
+        upsertArray.append(row->movie.toJson());
+    }
+    QJsonArray deleteArray;
+    for (qint64 id : deletes) {
+        deleteArray.append(id);
+    }
+    const QJsonObject body{{"revision", m_revision}, {"upserts", upsertArray}, {"deletes", deleteArray}};
+    response.body = QJsonDocument(body).toJson(QJsonDocument::Compact);
+    return response;
+}
+
+// ---- Writes
+
+QString MockMovieServer::identityKey(const QString& name, int year, const QDate& date) {
+    return name + QChar(0x1f) + QString::number(year) + QChar(0x1f) + date.toString(Qt::ISODate);
+}
+
+QString MockMovieServer::duplicateKey(const QString& name, int year) {
+    return name.trimmed().toLower() + QChar(0x1f) + QString::number(year);
+}
+
+void MockMovieServer::indexRow(qint64 id) {
+    const Movie& movie = m_rows[id].movie;
+    m_byIdentity.insert(identityKey(movie.getName(), movie.getYear(), movie.getDateAdded()), id);
+    m_byDuplicateKey.insert(duplicateKey(movie.getName(), movie.getYear()), id);
+}
+
+void MockMovieServer::unindexRow(qint64 id) {
+    const Movie& movie = m_rows[id].movie;
+    const QString identity = identityKey(movie.getName(), movie.getYear(), movie.getDateAdded());
+    if (m_byIdentity.value(identity) == id) {
+        m_byIdentity.remove(identity);
+    }
+    m_byDuplicateKey.remove(duplicateKey(movie.getName(), movie.getYear()), id);
+}
+
+qint64 MockMovieServer::findByIdentity(const QJsonObject& key) const {
+    const QDate date = QDate::fromString(key.value("date_added").toString(), Qt::ISODate);
+    return m_byIdentity.value(identityKey(key.value("name").toString(), key.value("year").toInt(), date), 0);
+}
+
+int MockMovieServer::applyCreate(const QJsonObject& payload, Movie& created, QString& detail) {
+    if (!payload.value("name").isString() || !payload.value("year").isDouble()) {
+        detail = "name and year are required";
+        return 422;
+    }
+    Movie movie = Movie::fromJson(payload);
+    movie.setName(movie.getName().trimmed());
+    movie.setDirector(movie.getDirector().trimmed());
+    movie.setNotes(movie.getNotes().trimmed());
+    if (!movie.getDateAdded().isValid()) {
+        movie.setDateAdded(QDate::currentDate());
+    }
+    // Duplicates by name (case-insensitive) and year, regardless of date
+    if (m_byDuplicateKey.contains(duplicateKey(movie.getName(), movie.getYear()))) {
+        detail = "Movie with the same name and year already exists";
+        return 409;
+    }
+    if (m_byIdentity.contains(identityKey(movie.getName(), movie.getYear(), movie.getDateAdded()))) {
+        detail = "UNIQUE constraint failed: movies.name, movies.year, movies.date_added";
+        return 400;
+    }
+    movie.setId(m_nextId++);
+    m_rows.insert(movie.getId(), Row{movie, ++m_revision});
+    indexRow(movie.getId());
+    created = movie;
+    return 200;
+}
+
+int MockMovieServer::applyUpdate(const QJsonObject& original, const QJsonObject& updated, Movie& result,
+                                 QString& detail) {
+    const qint64 id = findByIdentity(original);
+    if (id == 0) {
+        detail = "Movie not found";
+        return 404;
+    }
+    const QDate date = QDate::fromString(updated.value("date_added").toString(), Qt::ISODate);
+    if (!updated.value("name").isString() || !updated.value("year").isDouble() || !date.isValid()) {
+        detail = "updated needs name, year and date_added";
+        return 422;
+    }
+    Movie movie = Movie::fromJson(updated);
+    movie.setName(movie.getName().trimmed());
+    movie.setDirector(movie.getDirector().trimmed());
+    movie.setNotes(movie.getNotes().trimmed());
+    movie.setId(id);
+    const qint64 clash = m_byIdentity.value(identityKey(movie.getName(), movie.getYear(), date), 0);
+    if (clash != 0 && clash != id) {
+        detail = "UNIQUE constraint failed: movies.name, movies.year, movies.date_added";
+        return 400;
+    }
+    unindexRow(id);
+    m_rows[id] = Row{movie, ++m_revision};
+    indexRow(id);
+    result = movie;
+    return 200;
+}
+
+int MockMovieServer::applyDelete(const QJsonObject& key, QString& detail) {
+    const qint64 id = findByIdentity(key);
+    if (id == 0) {
+        detail = "Movie not found";
+        return 404;
+    }
+    unindexRow(id);
+    m_rows.remove(id);
+    m_tombstones.append({id, ++m_revision});
+    return 200;
+}
+
+MockMovieServer::Response MockMovieServer::createMovie(const QJsonObject& body) {
+    Movie created;
+    QString detail;
+    const int status = applyCreate(body, created, detail);
+    if (status != 200) {
+        return error(status, status == 400 ? "Could not create movie: " + detail : detail);
+    }
+    return json(200, created.toJson());
+}
+
+MockMovieServer::Response MockMovieServer::updateMovie(const QJsonObject& body) {
+    if (!body.value("original").isObject() || !body.value("updated").isObject()) {
+        return error(422, "original and updated are required");
+    }
+    Movie result;
+    QString detail;
+    const int status = applyUpdate(body.value("original").toObject(), body.value("updated").toObject(), result, detail);
+    if (status != 200) {
+        return error(status, status == 400 ? "Could not update movie: " + detail : detail);
+    }
+    return json(200, result.toJson());
+}
+
+MockMovieServer::Response MockMovieServer::deleteMovie(const QJsonObject& body) {
+    QString detail;
+    const int status = applyDelete(body, detail);
+    if (status != 200) {
+        return error(status, detail);
+    }
+    return json(200, QJsonObject{{"ok", true}});
+}
+
+MockMovieServer::Response MockMovieServer::batchWrite(const QJsonObject& body) {
+    // The whole request is validated first, as pydantic would, before anything is applied
+    const QJsonArray operations = body.value("operations").toArray();
+    if (!body.value("operations").isArray()) {
+        return error(422, "operations is required");
+    }
+    if (operations.size() > kMaxBatch) {
+        return error(422, QString("operations: at most %1 items").arg(kMaxBatch));
+    }
+    for (const QJsonValue& value : operations) {
+        const QString op = value.toObject().value("op").toString();
+        if (op != "create" && op != "update" && op != "delete") {
+            return error(422, "op must be one of 'create', 'update', 'delete'");
+        }
+    }
+
+    // Each operation stands alone: a failure is reported in its result and the rest still apply
+    QJsonArray results;
+    for (const QJsonValue& value : operations) {
+        const QJsonObject operation = value.toObject();
+        const QString op = operation.value("op").toString();
+        Movie movie;
+        QString detail;
+        int status = 200;
+        bool hasMovie = false;
+        if (op == "create") {
+            if (!operation.value("movie").isObject()) {
+                status = 422;
+                detail = "create needs 'movie'";
+            } else {
+                status = applyCreate(operation.value("movie").toObject(), movie, detail);
+                hasMovie = status == 200;
+            }
+        } else if (!operation.value("original").isObject()) {
+            status = 422;
+            detail = op + " needs 'original'";
+        } else if (op == "update") {
+            if (!operation.value("updated").isObject()) {
+                status = 422;
+                detail = "update needs 'updated'";
+            } else {
+                status = applyUpdate(operation.value("original").toObject(), operation.value("updated").toObject(),
+                                     movie, detail);
+                hasMovie = status == 200;
+            }
+        } else {
+            status = applyDelete(operation.value("original").toObject(), detail);
+        }
+        if (status == 400) {
+            detail = "Could not apply " + op + ": " + detail;
+        }
+        QJsonObject result{{"status", status}};
+        result["movie"] = hasMovie ? QJsonValue(movie.toJson()) : QJsonValue(QJsonValue::Null);
+        result["detail"] = detail.isEmpty() ? QJsonValue(QJsonValue::Null) : QJsonValue(detail);
+        results.append(result);
+    }
+    return json(200, QJsonObject{{"revision", m_revision}, {"results", results}});
+}
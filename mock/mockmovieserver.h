@@ -0,0 +1,150 @@
+// ============== MockMovieServer.h ==============
+#ifndef MOCKMOVIESERVER_H
+#define MOCKMOVIESERVER_H
+
+#include "movie.h"
+#include <QByteArray>
+#include <QHash>
+#include <QHostAddress>
+#include <QMap>
+#include <QMultiHash>
+#include <QObject>
+#include <QRandomGenerator>
+#include <QTcpServer>
+#include <QVector>
+
+class QTcpSocket;
+class QTimer;
+class QUrlQuery;
+
+// In-memory stand-in for backend/app.py on a QTcpServer, so MovieDatabase can be
+// exercised and timed without Python, SQLite or a network. It speaks the same
+// HTTP/JSON contract: GET /movies (filters, sort, keyset paging), GET
+// /movies/changes, POST/PUT /movies, POST /movies/delete and POST /movies/batch,
+// with the same status codes and detail messages, plus CBOR bulk reads.
+//
+// Network conditions are injected per request: a fixed latency plus jitter
+// before the response, a bandwidth cap while it is written, and a chance of
+// answering 503 or of never answering at all (the client's timeout fires).
+// Random choices come from a seeded generator, so runs are repeatable.
+//
+// The server lives on the thread that owns it. Tests can use it on the client's
+// thread, since both only run in the event loop; benchmarks that should not
+// count server work can moveToThread() it and call listen() on that thread.
+class MockMovieServer : public QObject {
+    Q_OBJECT
+
+public:
+    struct Options {
+        int latencyMs = 0;         // added before every response
+        int jitterMs = 0;          // plus a uniform 0..jitterMs
+        qint64 bytesPerSecond = 0; // response write rate, 0 = unlimited
+        double errorRate = 0.0;    // fraction of requests answered 503
+        double timeoutRate = 0.0;  // fraction of requests never answered
+        quint32 seed = 1;          // for the jitter and the injected failures
+    };
+
+    explicit MockMovieServer(QObject* parent = nullptr);
+    ~MockMovieServer() override;
+
+    bool listen(const QHostAddress& address = QHostAddress::LocalHost, quint16 port = 0);
+    void close();
+    quint16 port() const { return m_server.serverPort(); }
+    QString baseUrl() const; // e.g. "http://127.0.0.1:54321", for MovieDatabase
+    QString errorString() const { return m_server.errorString(); }
+
+    void setOptions(const Options& options);
+    Options options() const { return m_options; }
+
+    // Replaces the collection: generated movies (see MovieGenerator) or given ones.
+    // Ids are assigned from 1 and each row gets its own revision, as if created in order.
+    void seed(int count, quint32 seed = 20240601);
+    void setMovies(const QVector<Movie>& movies);
+    QVector<Movie> movies() const;
+    int movieCount() const { return m_rows.size(); }
+    qint64 revision() const { return m_revision; }
+
+    // Counters since construction
+    int requestsHandled() const { return m_requests; }
+    int errorsInjected() const { return m_errorsInjected; }
+    int timeoutsInjected() const { return m_timeoutsInjected; }
+    qint64 bytesSent() const { return m_bytesSent; }
+
+signals:
+    void requestHandled(const QString& method, const QString& path, int status);
+
+private:
+    struct Request {
+        QByteArray method;
+        QByteArray target;
+        QHash<QByteArray, QByteArray> headers; // names lower-cased
+        QByteArray body;
+    };
+    struct Response {
+        int status = 200;
+        QByteArray contentType = "application/json";
+        QByteArray body;
+        QList<QPair<QByteArray, QByteArray>> headers;
+    };
+    struct Connection {
+        QTcpSocket* socket = nullptr;
+        QTimer* pacer = nullptr;
+        QByteArray inbox;
+        QByteArray outbox;
+        bool busy = false;     // a request is being answered; later ones wait in inbox
+        bool hung = false;     // an injected timeout: this connection never answers again
+        bool closeAfter = false;
+    };
+    struct Row {
+        Movie movie;
+        qint64 revision = 0;
+    };
+
+    void onNewConnection();
+    void processInbox(Connection* connection);
+    static bool takeRequest(QByteArray& inbox, Request& request, bool& malformed);
+    void respond(Connection* connection, const Request& request);
+    void send(Connection* connection, const Response& response);
+    void pace(Connection* connection);
+    void finishResponse(Connection* connection);
+
+    Response handle(const Request& request);
+    Response listMovies(const QUrlQuery& query, bool cbor);
+    Response listChanges(const QUrlQuery& query, bool cbor);
+    Response createMovie(const QJsonObject& body);
+    Response updateMovie(const QJsonObject& body);
+    Response deleteMovie(const QJsonObject& body);
+    Response batchWrite(const QJsonObject& body);
+
+    // Operations shared by the single and batch endpoints; status 200 on success
+    int applyCreate(const QJsonObject& payload, Movie& created, QString& detail);
+    int applyUpdate(const QJsonObject& original, const QJsonObject& updated, Movie& result, QString& detail);
+    int applyDelete(const QJsonObject& key, QString& detail);
+    qint64 findByIdentity(const QJsonObject& key) const;
+
+    static QString identityKey(const QString& name, int year, const QDate& date);
+    static QString duplicateKey(const QString& name, int year);
+    void indexRow(qint64 id);
+    void unindexRow(qint64 id);
+    static Response json(int status, const QJsonValue& value);
+    static Response error(int status, const QString& detail);
+
+    QTcpServer m_server;
+    Options m_options;
+    QRandomGenerator m_random;
+    QHash<QTcpSocket*, Connection*> m_connections;
+
+    QMap<qint64, Row> m_rows;                     // by id
+    QHash<QString, qint64> m_byIdentity;          // exact (name, year, date_added)
+    QMultiHash<QString, qint64> m_byDuplicateKey; // lower-cased name + year
+    QVector<QPair<qint64, qint64>> m_tombstones;  // (movie id, revision)
+    qint64 m_revision = 0;
+    qint64 m_nextId = 1;
+
+    int m_requests = 0;
+    int m_errorsInjected = 0;
+    int m_timeoutsInjected = 0;
+    qint64 m_bytesSent = 0;
+};
+
+#endif // MOCKMOVIESERVER_H
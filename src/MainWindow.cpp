@@ -1,6 +1,8 @@
 
 // ============== MainWindow.cpp ==============
 #include "MainWindow.h"
+#include "diagnosticsdialog.h"
+#include "tracing.h"
 #include <QApplication>
 #include <QMessageBox>
 #include <QHeaderView>
@@ -10,23 +12,69 @@
 #include <QVariant>
 
 MainWindow::MainWindow(QWidget *parent)
-    : QMainWindow(parent), m_database(new MovieDatabase()), m_editingIndex(-1)
+    : MainWindow(new MovieDatabase(), parent)
 {
-    setupUI();
-    
-    // Optionally wait for backend to be ready (in case it is being auto-started)
-    m_database->waitUntilReady(10000);
-    // Load existing movies
-    if (!m_database->loadFromApi()) {
-        showStatusMessage("Error loading movies: " + m_database->getLastError());
+    // Opt-in compact wire format for bulk reads (MOVIE_API_CBOR=1)
+    m_database->setPreferCbor(qEnvironmentVariableIntValue("MOVIE_API_CBOR") != 0);
+
+    // Periodic metrics file (MOVIE_METRICS_FILE=path; .json for JSON, anything else for Prometheus text)
+    const QString metricsPath = qEnvironmentVariable("MOVIE_METRICS_FILE");
+    if (!metricsPath.isEmpty()) {
+        const int seconds = qEnvironmentVariableIntValue("MOVIE_METRICS_INTERVAL");
+        m_database->metrics().startDump(metricsPath, (seconds > 0 ? seconds : 60) * 1000);
+    }
+
+    // Show the cached collection immediately; the sync below only fetches what changed since
+    m_database->setSnapshotPath(MovieDatabase::defaultSnapshotPath(m_database->getApiBaseUrl()));
+    if (m_database->loadSnapshot()) {
+        showStatusMessage(QString("Loaded %1 cached movies, syncing...").arg(m_database->getMovieCount()), 0);
     } else {
-        showStatusMessage(QString("Loaded %1 movies").arg(m_database->getMovieCount()));
-        refreshTable();
+        showStatusMessage("Connecting to backend...", 0);
     }
+
+    // Edits show up at once and are journaled, then sent to the backend in the background
+    if (!m_database->enableOptimisticWrites(MovieDatabase::defaultJournalPath(m_database->getApiBaseUrl()))) {
+        qWarning() << "Optimistic writes disabled:" << m_database->getLastError();
+    }
+    connect(m_database, &MovieDatabase::writeRejected, this, [this](const Movie& movie, const QString& error) {
+        QMessageBox::warning(this, "Change Rejected",
+                             QString("The server rejected a change to %1 (%2):\n%3\n\nThe list has been reloaded.")
+                                 .arg(movie.getName()).arg(movie.getYear()).arg(error));
+    });
+
+    // Wait for the backend (in case it is being auto-started), then sync without blocking the UI
+    m_database->waitUntilReadyAsync(10000, [this](bool, const QString&) {
+        // Without a snapshot the first sync is a full load and records the change cursor
+        m_database->syncFromApiAsync([this](bool ok, const QString& error) {
+            if (!ok) {
+                showStatusMessage("Error loading movies: " + error);
+            } else {
+                showStatusMessage(QString("Loaded %1 movies").arg(m_database->getMovieCount()));
+            }
+        });
+    });
+}
+
+MainWindow::MainWindow(MovieDatabase* database, QWidget *parent)
+    : QMainWindow(parent), m_database(database), m_lastResultsVersion(0),
+      m_hasLastResults(false), m_isEditing(false)
+{
+    m_searchDebounce.setSingleShot(true);
+    m_searchDebounce.setInterval(200);
+    connect(&m_searchDebounce, &QTimer::timeout, this, &MainWindow::searchMovies);
+    setupUI();
+    
+    // Any change to the collection (load, sync, confirmed write) redraws the table
+    connect(m_database, &MovieDatabase::moviesChanged, this, &MainWindow::onMoviesChanged);
+    // Let go of the shown rows first, so the database changes its columns in place
+    connect(m_database, &MovieDatabase::moviesAboutToChange, m_movieModel, &MovieTableModel::releaseView);
+    connect(m_database, &MovieDatabase::writesConfirmed, this, &MainWindow::onWritesConfirmed);
+    refreshTable();
 }
 
 MainWindow::~MainWindow()
 {
+    delete m_diagnosticsDialog; // it reads the database's metrics
     delete m_database;
 }
 
@@ -65,6 +113,7 @@ void MainWindow::setupUI()
     m_editButton = new QPushButton("Edit Selected");
     m_deleteButton = new QPushButton("Delete Selected");
     m_deleteButton->setStyleSheet("background-color: #dc3545;");
+    m_diagnosticsButton = new QPushButton("Diagnostics");
     
     // Sort controls
     QLabel* sortLabel = new QLabel("Sort by:");
@@ -80,6 +129,7 @@ void MainWindow::setupUI()
     
     tableButtonLayout->addWidget(m_editButton);
     tableButtonLayout->addWidget(m_deleteButton);
+    tableButtonLayout->addWidget(m_diagnosticsButton);
     tableButtonLayout->addStretch();
     tableButtonLayout->addWidget(sortLabel);
     tableButtonLayout->addWidget(m_sortByCombo);
@@ -137,15 +187,15 @@ void MainWindow::setupUI()
         QLineEdit:focus, QSpinBox:focus, QTextEdit:focus, QDateEdit:focus {
             border-color: #007AFF;
         }
-        QTableWidget {
+        QTableView {
             gridline-color: #e0e0e0;
             background-color: white;
             alternate-background-color: #f9f9f9;
         }
-        QTableWidget::item {
+        QTableView::item {
             padding: 4px;
         }
-        QTableWidget::item:selected {
+        QTableView::item:selected {
             background-color: #007AFF;
             color: white;
         }
@@ -153,10 +203,14 @@ void MainWindow::setupUI()
 
     // Sorting change triggers table refresh based on current view
     connect(m_sortByCombo, &QComboBox::currentTextChanged, this, [this](const QString&) {
+        if (isServerSide()) {
+            showRemoteQuery(); // the server sorts; start again from the first page
+            return;
+        }
         // Re-apply sorting to current movies and refresh table
-        QVector<Movie> copy = m_currentMovies;
-        applySorting(copy);
-        updateMovieTable(copy);
+        QVector<int> rows = m_movieModel->view().rows();
+        applySorting(rows);
+        updateMovieTable(rows);
     });
 }
 
@@ -221,6 +275,12 @@ void MainWindow::setupSearchPanel()
     m_searchDirectorEdit = new QLineEdit;
     m_searchDirectorEdit->setPlaceholderText("Exact director name...");
     searchLayout->addRow("Director:", m_searchDirectorEdit);
+
+    // Full-text search over the notes (and names), best matches first
+    m_searchReviewEdit = new QLineEdit;
+    m_searchReviewEdit->setPlaceholderText("Words from your notes...");
+    m_searchReviewEdit->setToolTip("Local search only; results are ranked by relevance");
+    searchLayout->addRow("Review text:", m_searchReviewEdit);
     
     // Date range
     m_startDateEdit = new QDateEdit;
@@ -236,6 +296,15 @@ void MainWindow::setupSearchPanel()
     // Favorites only
     m_favoritesOnlyCheckBox = new QCheckBox("Favorites only");
     searchLayout->addRow("", m_favoritesOnlyCheckBox);
+
+    // Tolerate typos in name and director; results are ranked by closeness
+    m_fuzzyCheckBox = new QCheckBox("Fuzzy match (typos)");
+    m_fuzzyCheckBox->setToolTip("Local search only; ignored with server-side search");
+    searchLayout->addRow("", m_fuzzyCheckBox);
+
+    // Page through results filtered and sorted by the backend instead of the local copy
+    m_serverSideCheckBox = new QCheckBox("Server-side search (paged)");
+    searchLayout->addRow("", m_serverSideCheckBox);
     
     // Search buttons
     QHBoxLayout* buttonLayout = new QHBoxLayout;
@@ -252,36 +321,55 @@ void MainWindow::setupSearchPanel()
     connect(m_clearSearchButton, &QPushButton::clicked, this, &MainWindow::clearSearch);
     connect(m_searchNameEdit, &QLineEdit::returnPressed, this, &MainWindow::searchMovies);
     connect(m_searchDirectorEdit, &QLineEdit::returnPressed, this, &MainWindow::searchMovies);
+    connect(m_searchReviewEdit, &QLineEdit::returnPressed, this, &MainWindow::searchMovies);
+    // Live search: each keystroke restarts the debounce timer, so only the pause after typing searches
+    auto scheduleSearch = [this]() {
+        // Server-side queries cost a round trip, so wait a little longer there
+        m_searchDebounce.setInterval(isServerSide() ? 400 : 200);
+        m_searchDebounce.start();
+    };
+    connect(m_searchNameEdit, &QLineEdit::textEdited, this, scheduleSearch);
+    connect(m_searchDirectorEdit, &QLineEdit::textEdited, this, scheduleSearch);
+    connect(m_searchReviewEdit, &QLineEdit::textEdited, this, scheduleSearch);
+    connect(m_fuzzyCheckBox, &QCheckBox::toggled, this, scheduleSearch);
+    connect(m_serverSideCheckBox, &QCheckBox::toggled, this, &MainWindow::refreshTable);
 }
 
 void MainWindow::setupMovieTable()
 {
-    m_movieTable = new QTableWidget;
-    m_movieTable->setColumnCount(6);
-    
-    QStringList headers = {"Movie Name", "Year", "Director", "Date Added", "Notes", "Favorite"};
-    m_movieTable->setHorizontalHeaderLabels(headers);
+    m_movieModel = new MovieTableModel(this);
+    m_movieTable = new QTableView;
+    m_movieTable->setModel(m_movieModel);
     
     // Configure table appearance
     m_movieTable->setAlternatingRowColors(true);
     m_movieTable->setSelectionBehavior(QAbstractItemView::SelectRows);
+    m_movieTable->setSelectionMode(QAbstractItemView::SingleSelection);
+    m_movieTable->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    m_movieTable->setWordWrap(false);
     m_movieTable->setSortingEnabled(true);
     m_movieTable->verticalHeader()->setVisible(false);
     
     // Set column widths
     QHeaderView* header = m_movieTable->horizontalHeader();
     header->setStretchLastSection(false);
-    header->resizeSection(0, 200); // Movie Name
-    header->resizeSection(1, 80);  // Year
-    header->resizeSection(2, 180); // Director
-    header->resizeSection(3, 120); // Date Added
-    header->resizeSection(4, 300); // Notes
-    header->resizeSection(5, 80);  // Favorite
+    header->resizeSection(MovieTableModel::NameColumn, 200);
+    header->resizeSection(MovieTableModel::YearColumn, 80);
+    header->resizeSection(MovieTableModel::DirectorColumn, 180);
+    header->resizeSection(MovieTableModel::DateAddedColumn, 120);
+    header->resizeSection(MovieTableModel::NotesColumn, 300);
+    header->resizeSection(MovieTableModel::FavoriteColumn, 80);
     
     // Connect table signals
-    connect(m_movieTable, &QTableWidget::cellDoubleClicked, this, &MainWindow::onTableDoubleClicked);
+    connect(m_movieTable, &QTableView::doubleClicked, this, [this](const QModelIndex& index) {
+        onTableDoubleClicked(index.row(), index.column());
+    });
     connect(m_editButton, &QPushButton::clicked, this, &MainWindow::editMovie);
     connect(m_deleteButton, &QPushButton::clicked, this, &MainWindow::deleteMovie);
+    connect(m_diagnosticsButton, &QPushButton::clicked, this, &MainWindow::showDiagnostics);
+    connect(m_movieModel, &MovieTableModel::fetchFailed, this, [this](const QString& error) {
+        showStatusMessage("Server search failed: " + error);
+    });
 }
 
 void MainWindow::addMovie()
@@ -294,7 +382,7 @@ void MainWindow::addMovie()
         return;
     }
     
-    if (m_editingIndex >= 0) {
+    if (m_isEditing) {
         // Update existing movie
         Movie updatedMovie(movieName, 
                           m_yearSpinBox->value(),
@@ -303,18 +391,20 @@ void MainWindow::addMovie()
                           m_favoriteCheckBox->isChecked());
         
         // Keep original date added
-        Movie originalMovie = m_currentMovies[m_editingIndex];
+        const Movie originalMovie = m_editingMovie;
         updatedMovie.setDateAdded(originalMovie.getDateAdded());
         
-        // Update in database using original identity
-        if (m_database->updateMovie(originalMovie, updatedMovie)) {
-            showStatusMessage(QString("Updated movie: %1").arg(movieName));
-        } else {
-            QMessageBox::warning(this, "Update Failed", m_database->getLastError());
-        }
+        // Update in database using original identity; the table refreshes when the reply arrives
+        m_database->updateMovieAsync(originalMovie, updatedMovie, [this, movieName](bool ok, const QString& error) {
+            if (ok) {
+                showStatusMessage(QString("Updated movie: %1").arg(movieName));
+            } else {
+                QMessageBox::warning(this, "Update Failed", error);
+            }
+        });
         
         // Exit edit mode
-        m_editingIndex = -1;
+        m_isEditing = false;
         m_addButton->setText("Add Movie");
         findChild<QLabel*>("editLabel")->setVisible(false);
     } else {
@@ -322,18 +412,17 @@ void MainWindow::addMovie()
         // Prevent duplicates by Name (case-insensitive) + Year
         const int newYear = m_yearSpinBox->value();
         const QString newName = movieName;
-        const QVector<Movie> all = m_database->getAllMovies();
-        for (const Movie& existing : all) {
-            if (existing.getYear() == newYear && existing.getName().compare(newName, Qt::CaseInsensitive) == 0) {
-                QMessageBox::warning(
-                    this,
-                    "Duplicate Movie",
-                    QString("%1 (%2) is already in your list.\nDuplicates are not allowed.")
-                        .arg(existing.getName())
-                        .arg(existing.getYear())
-                );
-                return;
-            }
+        const int duplicateRow = m_database->findDuplicate(newName, newYear);
+        if (duplicateRow >= 0) {
+            const Movie existing = m_database->movieAt(duplicateRow);
+            QMessageBox::warning(
+                this,
+                "Duplicate Movie",
+                QString("%1 (%2) is already in your list.\nDuplicates are not allowed.")
+                    .arg(existing.getName())
+                    .arg(existing.getYear())
+            );
+            return;
         }
 
         Movie movie(movieName, 
@@ -342,12 +431,14 @@ void MainWindow::addMovie()
                     m_notesEdit->toPlainText().trimmed(),
                     m_favoriteCheckBox->isChecked());
         
-        // Add to database
-        if (m_database->addMovie(movie)) {
-            showStatusMessage(QString("Added movie: %1").arg(movieName));
-        } else {
-            QMessageBox::warning(this, "Add Failed", m_database->getLastError());
-        }
+        // Add to database; the table refreshes when the reply arrives
+        m_database->addMovieAsync(movie, [this, movieName](bool ok, const QString& error) {
+            if (ok) {
+                showStatusMessage(QString("Added movie: %1").arg(movieName));
+            } else {
+                QMessageBox::warning(this, "Add Failed", error);
+            }
+        });
     }
     
     // Update display
@@ -355,143 +446,181 @@ void MainWindow::addMovie()
     clearAddForm();
 }
 
+MovieQuery MainWindow::currentQuery() const
+{
+    MovieQuery query;
+    query.nameContains = m_searchNameEdit->text().trimmed();
+    query.directorContains = m_searchDirectorEdit->text().trimmed();
+    query.addedFrom = m_startDateEdit->date();
+    query.addedTo = m_endDateEdit->date();
+    query.favoritesOnly = m_favoritesOnlyCheckBox->isChecked();
+    return query;
+}
+
 void MainWindow::searchMovies()
 {
-    QVector<Movie> results = m_database->getAllMovies();
-    
-    // Apply name filter
-    QString searchName = m_searchNameEdit->text().trimmed();
-    if (!searchName.isEmpty()) {
-        results = m_database->searchByName(searchName);
+    // All filters go into one query that the database evaluates in a single pass
+    TRACE_SCOPE("MainWindow::searchMovies");
+    m_searchDebounce.stop();
+    const MovieQuery query = currentQuery();
+    if (isServerSide()) {
+        m_remoteQuery = query;
+        showRemoteQuery();
+        showStatusMessage("Searching on server...");
+        return;
     }
 
-    // Apply director filter (partial match, case-insensitive)
-    QString searchDirector = m_searchDirectorEdit->text().trimmed();
-    if (!searchDirector.isEmpty()) {
-        QVector<Movie> directorFiltered;
-        for (const Movie& movie : results) {
-            if (movie.getDirector().contains(searchDirector, Qt::CaseInsensitive)) {
-                directorFiltered.append(movie);
-            }
-        }
-        results = directorFiltered;
+    const QString reviewText = m_searchReviewEdit->text().trimmed();
+    if (!reviewText.isEmpty()) {
+        // Ranked by relevance rather than the sort combo; the other fields still filter
+        m_database->cancelScans();
+        m_hasLastResults = false;
+        const QVector<int> results = m_database->textQuery(reviewText, query);
+        updateMovieTable(results);
+        showStatusMessage(QString("Found %1 movies (best matches first)").arg(results.size()));
+        return;
     }
-    
-    // Apply date range filter
-    if (!results.isEmpty()) {
-        QDate startDate = m_startDateEdit->date();
-        QDate endDate = m_endDateEdit->date();
-        
-        QVector<Movie> dateFiltered;
-        for (const Movie& movie : results) {
-            QDate movieDate = movie.getDateAdded();
-            if (movieDate >= startDate && movieDate <= endDate) {
-                dateFiltered.append(movie);
-            }
-        }
-        results = dateFiltered;
+    if (m_fuzzyCheckBox->isChecked()) {
+        // Index lookups only, so this runs in place; ranked closest first, not by the sort combo
+        m_database->cancelScans();
+        m_hasLastResults = false;
+        const QVector<int> results = m_database->fuzzyQuery(query);
+        updateMovieTable(results);
+        showStatusMessage(QString("Found %1 movies (closest matches first)").arg(results.size()));
+        return;
     }
-    
-    // Apply favorites filter
-    if (m_favoritesOnlyCheckBox->isChecked() && !results.isEmpty()) {
-        QVector<Movie> favoriteFiltered;
-        for (const Movie& movie : results) {
-            if (movie.isFavorite()) {
-                favoriteFiltered.append(movie);
-            }
-        }
-        results = favoriteFiltered;
+
+    // Scanned off the UI thread; a newer search or refresh supersedes this one before it lands
+    auto show = [this, query](const QVector<int>& rows) {
+        TRACE_SCOPE("MainWindow::showResults");
+        m_lastQuery = query;
+        m_lastResults = rows;
+        m_lastResultsVersion = m_database->storeVersion();
+        m_hasLastResults = true;
+
+        // Apply current sort selection before displaying
+        QVector<int> results = rows;
+        applySorting(results);
+        updateMovieTable(results);
+        showStatusMessage(QString("Found %1 movies").arg(results.size()));
+    };
+    // Typing more of a word only removes matches, so filter the previous result instead of
+    // rescanning the collection; the rows are only valid while the store is unchanged
+    if (m_hasLastResults && m_lastResultsVersion == m_database->storeVersion() && query.narrows(m_lastQuery)) {
+        m_database->refineAsync(m_lastResults, query, show);
+    } else {
+        showStatusMessage("Searching...");
+        m_database->queryAsync(query, show);
     }
-    
-    // Apply current sort selection before displaying
-    applySorting(results);
-    updateMovieTable(results);
-    showStatusMessage(QString("Found %1 movies").arg(results.size()));
 }
 
 void MainWindow::clearSearch()
 {
     m_searchNameEdit->clear();
     m_searchDirectorEdit->clear();
+    m_searchReviewEdit->clear();
     m_startDateEdit->setDate(QDate::currentDate().addDays(-30));
     m_endDateEdit->setDate(QDate::currentDate());
     m_favoritesOnlyCheckBox->setChecked(false);
+    m_remoteQuery = MovieQuery();
+    m_searchDebounce.stop();
+    m_hasLastResults = false;
     
     refreshTable();
     showStatusMessage("Showing all movies");
+    if (isServerSide()) {
+        return; // pages come straight from the server; no local copy to sync
+    }
+    
+    // Pick up changes made elsewhere; only rows changed since the last sync are transferred
+    m_database->syncFromApiAsync([this](bool ok, const QString& error) {
+        if (!ok) {
+            showStatusMessage("Sync failed: " + error);
+        }
+    });
 }
 
 void MainWindow::refreshTable()
 {
-    m_currentMovies = m_database->getAllMovies();
-    QVector<Movie> sorted = m_currentMovies;
+    TRACE_SCOPE("MainWindow::refreshTable");
+    m_database->cancelScans(); // a search still running must not replace this view
+    if (isServerSide()) {
+        showRemoteQuery();
+        return;
+    }
+    QVector<int> sorted = m_database->allRows();
     applySorting(sorted);
     updateMovieTable(sorted);
 }
 
-void MainWindow::updateMovieTable(const QVector<Movie>& movies)
+void MainWindow::onMoviesChanged()
 {
-    m_currentMovies = movies; // Store current view
-    m_movieTable->setRowCount(movies.size());
-    
-    for (int i = 0; i < movies.size(); ++i) {
-        const Movie& movie = movies[i];
-        
-        m_movieTable->setItem(i, 0, new QTableWidgetItem(movie.getName()));
-        m_movieTable->setItem(i, 1, new QTableWidgetItem(QString::number(movie.getYear())));
-        m_movieTable->setItem(i, 2, new QTableWidgetItem(movie.getDirector()));
-        m_movieTable->setItem(i, 3, new QTableWidgetItem(movie.getDateAdded().toString("yyyy-MM-dd")));
-        m_movieTable->setItem(i, 4, new QTableWidgetItem(movie.getNotes()));
-        m_movieTable->setItem(i, 5, new QTableWidgetItem(movie.isFavorite() ? "★" : ""));
+    // Server-side pages don't come from the local collection, and restarting the query
+    // would drop them and the scroll position on every background sync
+    if (!isServerSide()) {
+        refreshTable();
     }
-    
-    // Auto-resize the notes column to fit content
-    m_movieTable->resizeRowsToContents();
 }
 
-void MainWindow::applySorting(QVector<Movie>& movies) const
+void MainWindow::onWritesConfirmed()
 {
-    if (movies.isEmpty()) return;
-    const QString key = m_sortByCombo ? m_sortByCombo->currentData().toString() : QString("date_desc");
+    // The user's own edits have reached the server, so its pages can now show them
+    if (isServerSide()) {
+        showRemoteQuery();
+    }
+}
 
-    auto compareDateAsc = [](const Movie& a, const Movie& b) {
-        return a.getDateAdded() < b.getDateAdded();
-    };
-    auto compareDateDesc = [](const Movie& a, const Movie& b) {
-        return a.getDateAdded() > b.getDateAdded();
-    };
-    auto compareNameAsc = [](const Movie& a, const Movie& b) {
-        return a.getName().localeAwareCompare(b.getName()) < 0;
-    };
-    auto compareNameDesc = [](const Movie& a, const Movie& b) {
-        return a.getName().localeAwareCompare(b.getName()) > 0;
-    };
-    auto compareYearAsc = [](const Movie& a, const Movie& b) {
-        return a.getYear() < b.getYear();
-    };
-    auto compareYearDesc = [](const Movie& a, const Movie& b) {
-        return a.getYear() > b.getYear();
-    };
+void MainWindow::updateMovieTable(const QVector<int>& rows)
+{
+    // The view shares the database's rows; the model formats cells on demand for visible rows
+    TraceSpan span("MainWindow::updateMovieTable");
+    span.setArg("rows", rows.size());
+    m_movieTable->setSortingEnabled(true);
+    m_movieModel->setView(m_database->view(rows));
+    m_movieTable->horizontalHeader()->setSortIndicator(-1, Qt::AscendingOrder);
+}
 
-    if (key == "date_asc") {
-        std::stable_sort(movies.begin(), movies.end(), compareDateAsc);
-    } else if (key == "name_asc") {
-        std::stable_sort(movies.begin(), movies.end(), compareNameAsc);
-    } else if (key == "name_desc") {
-        std::stable_sort(movies.begin(), movies.end(), compareNameDesc);
-    } else if (key == "year_asc") {
-        std::stable_sort(movies.begin(), movies.end(), compareYearAsc);
-    } else if (key == "year_desc") {
-        std::stable_sort(movies.begin(), movies.end(), compareYearDesc);
+void MainWindow::showRemoteQuery()
+{
+    // Header clicks could only reorder the pages loaded so far, so they are off in this mode
+    MovieDatabase::SortKey key;
+    bool descending;
+    currentSort(key, descending);
+    m_movieTable->setSortingEnabled(false);
+    m_movieTable->horizontalHeader()->setSortIndicator(-1, Qt::AscendingOrder);
+    m_movieModel->setRemoteQuery(m_database, m_remoteQuery, key, descending);
+}
+
+void MainWindow::currentSort(MovieDatabase::SortKey& key, bool& descending) const
+{
+    const QString name = m_sortByCombo ? m_sortByCombo->currentData().toString() : QString("date_desc");
+    descending = name.endsWith("_desc");
+    if (name.startsWith("name")) {
+        key = MovieDatabase::SortByName;
+    } else if (name.startsWith("year")) {
+        key = MovieDatabase::SortByYear;
     } else {
-        // default date_desc
-        std::stable_sort(movies.begin(), movies.end(), compareDateDesc);
+        key = MovieDatabase::SortByDateAdded;
     }
 }
 
+void MainWindow::applySorting(QVector<int>& rows) const
+{
+    if (rows.isEmpty()) return;
+    TraceSpan span("MainWindow::applySorting");
+    span.setArg("rows", rows.size());
+    MovieDatabase::SortKey key;
+    bool descending;
+    currentSort(key, descending);
+
+    // Orders come from indexes the database keeps up to date, so no comparisons
+    // (and no locale collation) happen here for a full refresh
+    rows = m_database->sortRows(rows, key, descending);
+}
+
 void MainWindow::editMovie()
 {
-    int currentRow = m_movieTable->currentRow();
+    int currentRow = m_movieTable->currentIndex().row();
     if (currentRow < 0) {
         QMessageBox::information(this, "No Selection", "Please select a movie to edit.");
         return;
@@ -502,18 +631,18 @@ void MainWindow::editMovie()
 
 void MainWindow::deleteMovie()
 {
-    int currentRow = m_movieTable->currentRow();
+    int currentRow = m_movieTable->currentIndex().row();
     if (currentRow < 0) {
         QMessageBox::information(this, "No Selection", "Please select a movie to delete.");
         return;
     }
     
-    if (currentRow >= m_currentMovies.size()) {
+    if (currentRow >= m_movieModel->rowCount()) {
         QMessageBox::warning(this, "Error", "Invalid selection.");
         return;
     }
     
-    Movie movieToDelete = m_currentMovies[currentRow];
+    Movie movieToDelete = m_movieModel->movieAt(currentRow);
     
     // Confirm deletion
     QMessageBox::StandardButton reply;
@@ -523,14 +652,14 @@ void MainWindow::deleteMovie()
                                  QMessageBox::Yes | QMessageBox::No);
     
     if (reply == QMessageBox::Yes) {
-        // Find the movie in the full database and remove it
-        if (m_database->deleteMovie(movieToDelete)) {
-            // Update display
-            refreshTable();
-            showStatusMessage(QString("Deleted movie: %1").arg(movieToDelete.getName()));
-        } else {
-            QMessageBox::warning(this, "Delete Failed", m_database->getLastError());
-        }
+        // Remove it in the backend; the table refreshes when the reply arrives
+        m_database->deleteMovieAsync(movieToDelete, [this, movieToDelete](bool ok, const QString& error) {
+            if (ok) {
+                showStatusMessage(QString("Deleted movie: %1").arg(movieToDelete.getName()));
+            } else {
+                QMessageBox::warning(this, "Delete Failed", error);
+            }
+        });
     }
 }
 
@@ -538,15 +667,16 @@ void MainWindow::onTableDoubleClicked(int row, int column)
 {
     Q_UNUSED(column)
     
-    if (row < 0 || row >= m_currentMovies.size()) {
+    if (row < 0 || row >= m_movieModel->rowCount()) {
         return;
     }
     
-    Movie movieToEdit = m_currentMovies[row];
+    Movie movieToEdit = m_movieModel->movieAt(row);
     populateEditForm(movieToEdit);
     
-    // Set edit mode
-    m_editingIndex = row;
+    // Set edit mode; keep the original so later table refreshes can't change what is being edited
+    m_editingMovie = movieToEdit;
+    m_isEditing = true;
     m_addButton->setText("Update Movie");
     findChild<QLabel*>("editLabel")->setVisible(true);
     
@@ -574,11 +704,23 @@ void MainWindow::clearAddForm()
     m_movieNameEdit->setFocus();
     
     // Reset edit mode
-    m_editingIndex = -1;
+    m_isEditing = false;
     m_addButton->setText("Add Movie");
     findChild<QLabel*>("editLabel")->setVisible(false);
 }
 
+void MainWindow::showDiagnostics()
+{
+    // Non-modal, so the numbers can be watched while using the app
+    if (!m_diagnosticsDialog) {
+        m_diagnosticsDialog = new DiagnosticsDialog(m_database->metrics(), this);
+        m_diagnosticsDialog->setAttribute(Qt::WA_DeleteOnClose);
+    }
+    m_diagnosticsDialog->show();
+    m_diagnosticsDialog->raise();
+    m_diagnosticsDialog->activateWindow();
+}
+
 void MainWindow::showStatusMessage(const QString& message, int timeout)
 {
     statusBar()->showMessage(message, timeout);
@@ -0,0 +1,94 @@
+// ============== DiagnosticsDialog.cpp ==============
+#include "diagnosticsdialog.h"
+#include <QApplication>
+#include <QClipboard>
+#include <QHBoxLayout>
+#include <QHeaderView>
+#include <QLabel>
+#include <QPushButton>
+#include <QTableWidget>
+#include <QVBoxLayout>
+
+namespace {
+
+enum Column { NameColumn, LabelsColumn, CountColumn, P50Column, P95Column, P99Column, MaxColumn, ColumnCount };
+
+QString milliseconds(double seconds) {
+    return QString::number(seconds * 1000.0, 'f', seconds < 0.01 ? 2 : 1);
+}
+
+} // namespace
+
+DiagnosticsDialog::DiagnosticsDialog(const Metrics& metrics, QWidget* parent)
+    : QDialog(parent), m_metrics(metrics)
+{
+    setWindowTitle("Diagnostics");
+    resize(900, 500);
+
+    m_table = new QTableWidget(0, ColumnCount);
+    m_table->setHorizontalHeaderLabels({"Metric", "Labels", "Count / Value", "p50 (ms)", "p95 (ms)", "p99 (ms)",
+                                        "Max (ms)"});
+    m_table->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    m_table->setSelectionBehavior(QAbstractItemView::SelectRows);
+    m_table->verticalHeader()->setVisible(false);
+    m_table->horizontalHeader()->setSectionResizeMode(LabelsColumn, QHeaderView::Stretch);
+
+    m_dumpLabel = new QLabel;
+    m_dumpLabel->setTextInteractionFlags(Qt::TextSelectableByMouse);
+
+    QPushButton* copyButton = new QPushButton("Copy as Text");
+    QPushButton* closeButton = new QPushButton("Close");
+    connect(copyButton, &QPushButton::clicked, this, &DiagnosticsDialog::copyAsText);
+    connect(closeButton, &QPushButton::clicked, this, &QDialog::accept);
+
+    QHBoxLayout* buttonLayout = new QHBoxLayout;
+    buttonLayout->addWidget(m_dumpLabel);
+    buttonLayout->addStretch();
+    buttonLayout->addWidget(copyButton);
+    buttonLayout->addWidget(closeButton);
+
+    QVBoxLayout* layout = new QVBoxLayout(this);
+    layout->addWidget(m_table);
+    layout->addLayout(buttonLayout);
+
+    connect(&m_refreshTimer, &QTimer::timeout, this, &DiagnosticsDialog::refresh);
+    m_refreshTimer.start(1000);
+    refresh();
+}
+
+void DiagnosticsDialog::refresh()
+{
+    const QVector<Metrics::Sample> samples = m_metrics.samples();
+    m_table->setRowCount(samples.size());
+    for (int row = 0; row < samples.size(); ++row) {
+        const Metrics::Sample& sample = samples[row];
+        QStringList cells(ColumnCount);
+        cells[NameColumn] = sample.name;
+        cells[LabelsColumn] = sample.labels;
+        cells[CountColumn] = QString::number(qint64(sample.value));
+        if (sample.kind == Metrics::Histogram && sample.value > 0) {
+            cells[P50Column] = milliseconds(sample.p50);
+            cells[P95Column] = milliseconds(sample.p95);
+            cells[P99Column] = milliseconds(sample.p99);
+            cells[MaxColumn] = milliseconds(sample.max);
+        }
+        for (int column = 0; column < ColumnCount; ++column) {
+            QTableWidgetItem* item = m_table->item(row, column);
+            if (!item) {
+                item = new QTableWidgetItem;
+                if (column >= CountColumn) {
+                    item->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
+                }
+                m_table->setItem(row, column, item);
+            }
+            item->setText(cells[column]);
+        }
+    }
+    m_dumpLabel->setText(m_metrics.dumpPath().isEmpty() ? QString("Not written to a file (set MOVIE_METRICS_FILE)")
+                                                        : "Written to " + m_metrics.dumpPath());
+}
+
+void DiagnosticsDialog::copyAsText()
+{
+    QApplication::clipboard()->setText(QString::fromUtf8(m_metrics.toPrometheus()));
+}
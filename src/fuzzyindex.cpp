@@ -0,0 +1,258 @@
+// ============== FuzzyIndex.cpp ==============
+#include "fuzzyindex.h"
+#include <QVarLengthArray>
+#include <algorithm>
+#include <limits>
+
+namespace {
+
+// FNV-1a over the UTF-16 code units; a collision only adds a candidate that
+// fails the edit-distance check
+quint64 variantKey(QStringView text) {
+    quint64 hash = 14695981039346656037ull;
+    for (QChar c : text) {
+        hash = (hash ^ c.unicode()) * 1099511628211ull;
+    }
+    return hash;
+}
+
+void insertSorted(QVector<int>& list, int value) {
+    // Rows are usually appended, so the common case is a push_back
+    if (list.isEmpty() || list.last() < value) {
+        list.append(value);
+    } else {
+        auto pos = std::lower_bound(list.begin(), list.end(), value);
+        if (pos == list.end() || *pos != value) {
+            list.insert(pos, value);
+        }
+    }
+}
+
+} // namespace
+
+void FuzzyIndex::clear() {
+    m_terms.clear();
+    m_freeTerms.clear();
+    m_termIds.clear();
+    m_deletes.clear();
+}
+
+QVector<QString> FuzzyIndex::wordsOf(QStringView text) {
+    // Runs of letters and digits, case-folded; each word is indexed once per row
+    QVector<QString> words;
+    qsizetype start = -1;
+    for (qsizetype i = 0; i <= text.size(); ++i) {
+        const bool inWord = i < text.size() && text[i].isLetterOrNumber();
+        if (inWord && start < 0) {
+            start = i;
+        } else if (!inWord && start >= 0) {
+            words.append(text.mid(start, i - start).toString().toCaseFolded());
+            start = -1;
+        }
+    }
+    std::sort(words.begin(), words.end());
+    words.erase(std::unique(words.begin(), words.end()), words.end());
+    return words;
+}
+
+int FuzzyIndex::deleteDepth(int length) {
+    // A term needs deletes as deep as the largest budget of any query word that
+    // could still match it: query words within one edit of a 3-letter term are
+    // at most 4 long (budget 1), and terms of 1-2 letters only match exactly
+    return length <= 2 ? 0 : length == 3 ? 1 : MaxDistance;
+}
+
+QVector<quint64> FuzzyIndex::deletesOf(QStringView word, int depth) {
+    const QStringView prefix = word.left(PrefixLength);
+    QVector<quint64> keys{variantKey(prefix)};
+    QVector<QString> level{prefix.toString()};
+    for (int d = 0; d < depth; ++d) {
+        QVector<QString> next;
+        for (const QString& variant : level) {
+            for (int i = 0; i < variant.size(); ++i) {
+                QString shorter = variant;
+                shorter.remove(i, 1);
+                keys.append(variantKey(shorter));
+                next.append(shorter);
+            }
+        }
+        level.swap(next);
+    }
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+    return keys;
+}
+
+int FuzzyIndex::editDistance(QStringView a, QStringView b, int max) {
+    // Optimal string alignment distance (Levenshtein plus adjacent transpositions),
+    // abandoned as soon as a whole row of the table exceeds max
+    if (qAbs(a.size() - b.size()) > max) {
+        return max + 1;
+    }
+    const int n = int(a.size());
+    const int m = int(b.size());
+    QVarLengthArray<int, 64> buffer(3 * (m + 1));
+    int* twoBack = buffer.data();
+    int* previous = twoBack + (m + 1);
+    int* current = previous + (m + 1);
+    for (int j = 0; j <= m; ++j) {
+        previous[j] = j;
+    }
+    for (int i = 1; i <= n; ++i) {
+        current[0] = i;
+        int rowMin = i;
+        for (int j = 1; j <= m; ++j) {
+            const int cost = a[i - 1] == b[j - 1] ? 0 : 1;
+            int value = std::min({previous[j] + 1, current[j - 1] + 1, previous[j - 1] + cost});
+            if (i > 1 && j > 1 && a[i - 1] == b[j - 2] && a[i - 2] == b[j - 1]) {
+                value = std::min(value, twoBack[j - 2] + 1);
+            }
+            current[j] = value;
+            rowMin = std::min(rowMin, value);
+        }
+        if (rowMin > max) {
+            return max + 1;
+        }
+        std::swap(twoBack, previous);
+        std::swap(previous, current);
+    }
+    return std::min(previous[m], max + 1);
+}
+
+void FuzzyIndex::addRow(int row, QStringView text) {
+    for (const QString& word : wordsOf(text)) {
+        int id = m_termIds.value(word, -1);
+        if (id < 0) {
+            if (m_freeTerms.isEmpty()) {
+                id = m_terms.size();
+                m_terms.append(Term());
+            } else {
+                id = m_freeTerms.takeLast();
+            }
+            m_terms[id].text = word;
+            m_termIds.insert(word, id);
+            for (quint64 key : deletesOf(word, deleteDepth(word.size()))) {
+                m_deletes[key].append(id);
+            }
+        }
+        insertSorted(m_terms[id].rows, row);
+    }
+}
+
+void FuzzyIndex::removeRow(int row, QStringView text) {
+    for (const QString& word : wordsOf(text)) {
+        auto idIt = m_termIds.find(word);
+        if (idIt == m_termIds.end()) {
+            continue;
+        }
+        const int id = idIt.value();
+        QVector<int>& rows = m_terms[id].rows;
+        auto pos = std::lower_bound(rows.begin(), rows.end(), row);
+        if (pos != rows.end() && *pos == row) {
+            rows.erase(pos);
+        }
+        if (!rows.isEmpty()) {
+            continue;
+        }
+        // Last row with this word: drop the term and its delete variants, reuse the id
+        for (quint64 key : deletesOf(word, deleteDepth(word.size()))) {
+            auto it = m_deletes.find(key);
+            if (it == m_deletes.end()) {
+                continue;
+            }
+            QVector<int>& ids = it.value();
+            auto found = std::find(ids.begin(), ids.end(), id);
+            if (found != ids.end()) {
+                *found = ids.last();
+                ids.removeLast();
+            }
+            if (ids.isEmpty()) {
+                m_deletes.erase(it);
+            }
+        }
+        m_termIds.erase(idIt);
+        m_terms[id] = Term();
+        m_freeTerms.append(id);
+    }
+}
+
+QVector<FuzzyIndex::TermMatch> FuzzyIndex::matchWord(const QString& word) const {
+    const int budget = maxDistanceFor(int(word.size()));
+    QVector<int> ids;
+    for (quint64 key : deletesOf(word, budget)) {
+        auto it = m_deletes.constFind(key);
+        if (it != m_deletes.constEnd()) {
+            ids += it.value();
+        }
+    }
+    std::sort(ids.begin(), ids.end());
+    ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+
+    QVector<TermMatch> matches;
+    for (int id : ids) {
+        const int distance = editDistance(word, m_terms[id].text, budget);
+        if (distance <= budget) {
+            matches.append({id, distance});
+        }
+    }
+    return matches;
+}
+
+QVector<FuzzyIndex::Match> FuzzyIndex::search(QStringView query) const {
+    const QVector<QString> words = wordsOf(query);
+    if (words.isEmpty()) {
+        return {};
+    }
+    QVector<QVector<TermMatch>> perWord;
+    QVector<qint64> rowTotals;
+    for (const QString& word : words) {
+        QVector<TermMatch> terms = matchWord(word);
+        if (terms.isEmpty()) {
+            return {};
+        }
+        qint64 total = 0;
+        for (const TermMatch& term : terms) {
+            total += m_terms[term.term].rows.size();
+        }
+        perWord.append(std::move(terms));
+        rowTotals.append(total);
+    }
+
+    // Expand the word with the fewest rows, then only probe those rows in the other words' lists
+    const int first = int(std::min_element(rowTotals.begin(), rowTotals.end()) - rowTotals.begin());
+    QVector<Match> matches;
+    matches.reserve(int(rowTotals[first]));
+    for (const TermMatch& term : perWord[first]) {
+        for (int row : m_terms[term.term].rows) {
+            matches.append({row, term.distance});
+        }
+    }
+    std::sort(matches.begin(), matches.end(), [](const Match& a, const Match& b) {
+        return a.row != b.row ? a.row < b.row : a.distance < b.distance;
+    });
+    matches.erase(std::unique(matches.begin(), matches.end(),
+                              [](const Match& a, const Match& b) { return a.row == b.row; }),
+                  matches.end());
+
+    QVector<Match> narrowed;
+    for (int w = 0; w < perWord.size() && !matches.isEmpty(); ++w) {
+        if (w == first) {
+            continue;
+        }
+        narrowed.clear();
+        for (const Match& match : matches) {
+            int best = std::numeric_limits<int>::max();
+            for (const TermMatch& term : perWord[w]) {
+                const QVector<int>& rows = m_terms[term.term].rows;
+                if (term.distance < best && std::binary_search(rows.begin(), rows.end(), match.row)) {
+                    best = term.distance;
+                }
+            }
+            if (best != std::numeric_limits<int>::max()) {
+                narrowed.append({match.row, match.distance + best});
+            }
+        }
+        matches.swap(narrowed);
+    }
+    return matches;
+}
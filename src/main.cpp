@@ -1,22 +1,46 @@
-
 // ============== main.cpp (GUI Version) ==============
 #include <QApplication>
+#include <QCommandLineParser>
+#include <QDebug>
 #include "MainWindow.h"
+#include "tracing.h"
 
 int main(int argc, char *argv[])
 {
     QApplication app(argc, argv);
-    
+
     // Set application properties
     app.setApplicationName("Movie Review Manager");
     app.setApplicationVersion("1.0");
     app.setOrganizationName("Your Name");
-    
+
+    // Trace spans are recorded for the whole session and written on exit (--trace or MOVIE_TRACE=file)
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    parser.addVersionOption();
+    QCommandLineOption traceOption("trace", "Write a Chrome trace of this session to <file>.", "file");
+    parser.addOption(traceOption);
+    parser.process(app);
+    const QString tracePath = parser.isSet(traceOption) ? parser.value(traceOption)
+                                                        : qEnvironmentVariable("MOVIE_TRACE");
+    if (!tracePath.isEmpty()) {
+        Trace::start();
+    }
+
     // No Docker auto-start. Expect the backend to be running separately.
-    
-    MainWindow window;
-    window.show();
-    
-    return app.exec();
-}
 
+    int result = 0;
+    {
+        MainWindow window;
+        window.show();
+        result = app.exec();
+    }
+
+    if (!tracePath.isEmpty()) {
+        QString error;
+        if (!Trace::stop(tracePath, &error)) {
+            qWarning() << "Failed to write trace" << tracePath << ":" << error;
+        }
+    }
+    return result;
+}
@@ -0,0 +1,270 @@
+// ============== Metrics.cpp ==============
+#include "metrics.h"
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QDebug>
+
+namespace {
+
+const double kBounds[MetricHistogram::BucketCount] = {
+    0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10, 30,
+};
+
+const char* kindName(Metrics::Kind kind) {
+    switch (kind) {
+    case Metrics::Counter: return "counter";
+    case Metrics::Gauge: return "gauge";
+    case Metrics::Histogram: return "histogram";
+    }
+    return "untyped";
+}
+
+QByteArray number(double value) {
+    return QByteArray::number(value, 'g', 12);
+}
+
+} // namespace
+
+// ---- MetricHistogram
+
+const double* MetricHistogram::bucketBounds() {
+    return kBounds;
+}
+
+void MetricHistogram::record(qint64 nanoseconds) {
+    const quint64 ns = quint64(qMax<qint64>(0, nanoseconds));
+    const double seconds = ns / 1e9;
+    int index = 0;
+    while (index < BucketCount && seconds > kBounds[index]) {
+        ++index;
+    }
+    m_buckets[index].fetch_add(1, std::memory_order_relaxed);
+    m_count.fetch_add(1, std::memory_order_relaxed);
+    m_sumNs.fetch_add(ns, std::memory_order_relaxed);
+    quint64 max = m_maxNs.load(std::memory_order_relaxed);
+    while (ns > max && !m_maxNs.compare_exchange_weak(max, ns, std::memory_order_relaxed)) {
+    }
+}
+
+double MetricHistogram::quantile(double q) const {
+    // Counters move while this runs; the bucket sum is the consistent total here
+    quint64 counts[BucketCount + 1];
+    quint64 total = 0;
+    for (int i = 0; i <= BucketCount; ++i) {
+        counts[i] = bucket(i);
+        total += counts[i];
+    }
+    if (total == 0) {
+        return 0.0;
+    }
+    const double max = maxSeconds();
+    const double target = q * double(total);
+    quint64 below = 0;
+    for (int i = 0; i <= BucketCount; ++i) {
+        if (counts[i] > 0 && double(below + counts[i]) >= target) {
+            if (i == BucketCount) {
+                return max; // past the last bound only the maximum is known
+            }
+            const double lower = i == 0 ? 0.0 : kBounds[i - 1];
+            const double upper = kBounds[i];
+            const double estimate = lower + (upper - lower) * (target - double(below)) / double(counts[i]);
+            return qMin(estimate, max);
+        }
+        below += counts[i];
+    }
+    return max;
+}
+
+// ---- Metrics
+
+Metrics::Metrics() {
+    QObject::connect(&m_dumpTimer, &QTimer::timeout, &m_dumpTimer, [this]() {
+        QString error;
+        if (!writeTo(m_dumpPath, &error)) {
+            qWarning() << "Failed to write metrics" << m_dumpPath << ":" << error;
+        }
+    });
+}
+
+Metrics::~Metrics() {
+    stopDump();
+}
+
+QString Metrics::label(const QString& key, const QString& value) {
+    QString escaped = value;
+    escaped.replace('\\', "\\\\").replace('"', "\\\"").replace('\n', "\\n");
+    return QString("%1=\"%2\"").arg(key, escaped);
+}
+
+void Metrics::describe(const QString& name, const QString& help) {
+    QMutexLocker locker(&m_mutex);
+    m_help.insert(name, help);
+}
+
+Metrics::Series& Metrics::series(Kind kind, const QString& name, const QString& labels) {
+    QMutexLocker locker(&m_mutex);
+    const QString key = name + '{' + labels + '}';
+    auto it = m_series.find(key);
+    if (it == m_series.end()) {
+        Series created;
+        created.kind = kind;
+        created.name = name;
+        created.labels = labels;
+        switch (kind) {
+        case Counter: created.counter = std::make_unique<MetricCounter>(); break;
+        case Gauge: created.gauge = std::make_unique<MetricGauge>(); break;
+        case Histogram: created.histogram = std::make_unique<MetricHistogram>(); break;
+        }
+        it = m_series.emplace(key, std::move(created)).first;
+    }
+    Q_ASSERT(it->second.kind == kind);
+    return it->second;
+}
+
+MetricCounter* Metrics::counter(const QString& name, const QString& labels) {
+    return series(Counter, name, labels).counter.get();
+}
+
+MetricGauge* Metrics::gauge(const QString& name, const QString& labels) {
+    return series(Gauge, name, labels).gauge.get();
+}
+
+MetricHistogram* Metrics::histogram(const QString& name, const QString& labels) {
+    return series(Histogram, name, labels).histogram.get();
+}
+
+QVector<Metrics::Sample> Metrics::samples() const {
+    QMutexLocker locker(&m_mutex);
+    QVector<Sample> result;
+    result.reserve(int(m_series.size()));
+    for (const auto& entry : m_series) {
+        const Series& s = entry.second;
+        Sample sample{s.name, s.labels, s.kind, 0, 0, 0, 0, 0, 0};
+        switch (s.kind) {
+        case Counter: sample.value = double(s.counter->value()); break;
+        case Gauge: sample.value = double(s.gauge->value()); break;
+        case Histogram:
+            sample.value = double(s.histogram->count());
+            sample.sum = s.histogram->sumSeconds();
+            sample.p50 = s.histogram->quantile(0.50);
+            sample.p95 = s.histogram->quantile(0.95);
+            sample.p99 = s.histogram->quantile(0.99);
+            sample.max = s.histogram->maxSeconds();
+            break;
+        }
+        result.append(sample);
+    }
+    return result;
+}
+
+QByteArray Metrics::toPrometheus() const {
+    QMutexLocker locker(&m_mutex);
+    QByteArray out;
+    QString family;
+    auto withLabels = [](const QString& labels, const QString& extra) {
+        const QString all = labels.isEmpty() ? extra : extra.isEmpty() ? labels : labels + ',' + extra;
+        return all.isEmpty() ? QByteArray() : '{' + all.toUtf8() + '}';
+    };
+    for (const auto& entry : m_series) {
+        const Series& s = entry.second;
+        const QByteArray name = s.name.toUtf8();
+        if (s.name != family) {
+            family = s.name;
+            if (m_help.contains(family)) {
+                out += "# HELP " + name + ' ' + m_help.value(family).toUtf8() + '\n';
+            }
+            out += "# TYPE " + name + ' ' + kindName(s.kind) + '\n';
+        }
+        switch (s.kind) {
+        case Counter:
+            out += name + withLabels(s.labels, QString()) + ' ' + QByteArray::number(s.counter->value()) + '\n';
+            break;
+        case Gauge:
+            out += name + withLabels(s.labels, QString()) + ' ' + QByteArray::number(s.gauge->value()) + '\n';
+            break;
+        case Histogram: {
+            // Buckets are cumulative in this format
+            quint64 cumulative = 0;
+            for (int i = 0; i <= MetricHistogram::BucketCount; ++i) {
+                cumulative += s.histogram->bucket(i);
+                const QString le = i < MetricHistogram::BucketCount
+                    ? QString::fromLatin1(number(kBounds[i])) : QStringLiteral("+Inf");
+                out += name + "_bucket" + withLabels(s.labels, label("le", le)) + ' '
+                    + QByteArray::number(cumulative) + '\n';
+            }
+            out += name + "_sum" + withLabels(s.labels, QString()) + ' ' + number(s.histogram->sumSeconds()) + '\n';
+            out += name + "_count" + withLabels(s.labels, QString()) + ' ' + QByteArray::number(cumulative) + '\n';
+            break;
+        }
+        }
+    }
+    return out;
+}
+
+QJsonObject Metrics::toJson() const {
+    QJsonArray series;
+    for (const Sample& sample : samples()) {
+        QJsonObject object;
+        object["name"] = sample.name;
+        object["labels"] = sample.labels;
+        object["type"] = QString::fromLatin1(kindName(sample.kind));
+        if (sample.kind == Histogram) {
+            object["count"] = sample.value;
+            object["sum_seconds"] = sample.sum;
+            object["p50_seconds"] = sample.p50;
+            object["p95_seconds"] = sample.p95;
+            object["p99_seconds"] = sample.p99;
+            object["max_seconds"] = sample.max;
+        } else {
+            object["value"] = sample.value;
+        }
+        series.append(object);
+    }
+    QJsonObject root;
+    root["timestamp"] = QDateTime::currentDateTimeUtc().toString(Qt::ISODateWithMs);
+    root["series"] = series;
+    return root;
+}
+
+bool Metrics::writeTo(const QString& path, QString* error) const {
+    // Atomic replace, so a collector (e.g. node_exporter's textfile directory) never reads half a file
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        if (error) *error = file.errorString();
+        return false;
+    }
+    if (path.endsWith(".json", Qt::CaseInsensitive)) {
+        file.write(QJsonDocument(toJson()).toJson(QJsonDocument::Indented));
+    } else {
+        file.write(toPrometheus());
+    }
+    if (!file.commit()) {
+        if (error) *error = file.errorString();
+        return false;
+    }
+    return true;
+}
+
+void Metrics::startDump(const QString& path, int intervalMs) {
+    stopDump();
+    m_dumpPath = path;
+    m_dumpTimer.start(qMax(1000, intervalMs));
+}
+
+void Metrics::stopDump() {
+    if (m_dumpPath.isEmpty()) {
+        return;
+    }
+    m_dumpTimer.stop();
+    QString error;
+    if (!writeTo(m_dumpPath, &error)) {
+        qWarning() << "Failed to write metrics" << m_dumpPath << ":" << error;
+    }
+    m_dumpPath.clear();
+}
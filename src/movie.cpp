@@ -1,76 +1,61 @@
 
 // ============== Movie.cpp ==============
 #include "movie.h"
+#include "moviecsv.h"
 #include <QStringList>
 #include <QJsonObject>
 #include <QJsonValue>
+#include <QCborStreamReader>
+#include <QCborStreamWriter>
 
-Movie::Movie() : m_year(0), m_dateAdded(QDate::currentDate()), m_isFavorite(false) {}
+namespace {
+
+const QDate kCborEpoch(1970, 1, 1);
+
+QString readCborText(QCborStreamReader& reader) {
+    if (!reader.isString()) {
+        reader.next(); // null or wrong type: default value, as in fromJson
+        return QString();
+    }
+    QString text;
+    auto chunk = reader.readString();
+    while (chunk.status == QCborStreamReader::Ok) {
+        text += chunk.data;
+        chunk = reader.readString();
+    }
+    return text;
+}
+
+qint64 readCborInteger(QCborStreamReader& reader) {
+    const qint64 value = reader.isInteger() ? qint64(reader.toInteger()) : 0;
+    reader.next();
+    return value;
+}
+
+} // namespace
+
+Movie::Movie() : m_year(0), m_dateAdded(QDate::currentDate()), m_isFavorite(false), m_id(0) {}
 
 Movie::Movie(const QString& name, int year, const QString& notes, bool isFavorite)
     : m_name(name), m_year(year), m_dateAdded(QDate::currentDate()), 
-      m_notes(notes), m_isFavorite(isFavorite) {}
+      m_notes(notes), m_isFavorite(isFavorite), m_id(0) {}
 
 Movie::Movie(const QString& name, int year, const QString& director, const QString& notes, bool isFavorite)
     : m_name(name), m_year(year), m_dateAdded(QDate::currentDate()),
-      m_director(director), m_notes(notes), m_isFavorite(isFavorite) {}
+      m_director(director), m_notes(notes), m_isFavorite(isFavorite), m_id(0) {}
 
 QString Movie::toCsvString() const {
-    QString escapedNotes = m_notes;
-    escapedNotes.replace("\"", "\"\""); // Escape quotes in notes
-    
-    QString escapedDirector = m_director;
-    escapedDirector.replace("\"", "\"\"");
-    
-    return QString("%1,%2,\"%3\",%4,\"%5\",%6")
-           .arg(m_name)
-           .arg(m_year)
-           .arg(escapedDirector)
-           .arg(m_dateAdded.toString("yyyy-MM-dd"))
-           .arg(escapedNotes)
-           .arg(m_isFavorite ? "1" : "0");
+    QByteArray record;
+    MovieCsv::appendRecord(record, *this);
+    return QString::fromUtf8(record);
 }
 
 Movie Movie::fromCsvString(const QString& csvLine) {
-    QStringList parts = csvLine.split(',');
-    if (parts.size() < 5) return Movie(); // Invalid format
-    
+    // Name, Year, Director, Date, Notes, Favorite; or the legacy layout without Director
     Movie movie;
-    if (parts.size() >= 6) {
-        // New format: Name, Year, Director, Date, Notes, Favorite
-        movie.setName(parts[0].trimmed());
-        movie.setYear(parts[1].toInt());
-        // Handle quoted director
-        QString director = parts[2].trimmed();
-        if (director.startsWith("\"") && director.endsWith("\"")) {
-            director = director.mid(1, director.length() - 2);
-            director.replace("\"\"", "\"");
-        }
-        movie.setDirector(director);
-        movie.m_dateAdded = QDate::fromString(parts[3].trimmed(), "yyyy-MM-dd");
-        // Handle quoted notes (remove quotes and unescape)
-        QString notes = parts[4].trimmed();
-        if (notes.startsWith("\"") && notes.endsWith("\"")) {
-            notes = notes.mid(1, notes.length() - 2);
-            notes.replace("\"\"", "\"");
-        }
-        movie.setNotes(notes);
-        movie.setFavorite(parts[5].trimmed() == "1");
-    } else {
-        // Legacy format: Name, Year, Date, Notes, Favorite
-        movie.setName(parts[0].trimmed());
-        movie.setYear(parts[1].toInt());
-        movie.m_dateAdded = QDate::fromString(parts[2].trimmed(), "yyyy-MM-dd");
-        // Handle quoted notes (remove quotes and unescape)
-        QString notes = parts[3].trimmed();
-        if (notes.startsWith("\"") && notes.endsWith("\"")) {
-            notes = notes.mid(1, notes.length() - 2);
-            notes.replace("\"\"", "\"");
-        }
-        movie.setNotes(notes);
-        movie.setFavorite(parts[4].trimmed() == "1");
+    if (!MovieCsv::parseRecord(csvLine.toUtf8(), movie)) {
+        return Movie(); // Invalid format
     }
-    
     return movie;
 }
 
@@ -82,6 +67,9 @@ QJsonObject Movie::toJson() const {
     obj["date_added"] = m_dateAdded.toString("yyyy-MM-dd");
     obj["notes"] = m_notes;
     obj["is_favorite"] = m_isFavorite;
+    if (m_id > 0) {
+        obj["id"] = m_id;
+    }
     return obj;
 }
 
@@ -93,6 +81,53 @@ Movie Movie::fromJson(const QJsonObject& obj) {
     movie.m_dateAdded = QDate::fromString(obj.value("date_added").toString(), "yyyy-MM-dd");
     movie.setNotes(obj.value("notes").toString());
     movie.setFavorite(obj.value("is_favorite").toBool());
+    movie.setId(obj.value("id").toInteger());
     return movie;
 }
 
+
+void Movie::toCbor(QCborStreamWriter& writer) const {
+    writer.startArray(7);
+    writer.append(m_id);
+    writer.append(m_name);
+    writer.append(qint64(m_year));
+    writer.append(m_director);
+    if (m_dateAdded.isValid()) {
+        writer.append(kCborEpoch.daysTo(m_dateAdded));
+    } else {
+        writer.append(nullptr);
+    }
+    writer.append(m_notes);
+    writer.append(m_isFavorite);
+    writer.endArray();
+}
+
+Movie Movie::fromCbor(QCborStreamReader& reader) {
+    Movie movie;
+    movie.m_dateAdded = QDate(); // as in fromJson, a missing date stays invalid
+    if (!reader.isArray() || !reader.enterContainer()) {
+        return movie;
+    }
+    // Fields are positional; extra trailing fields from newer servers are skipped
+    int field = 0;
+    while (reader.lastError() == QCborError::NoError && reader.hasNext()) {
+        switch (field++) {
+        case 0: movie.setId(readCborInteger(reader)); break;
+        case 1: movie.setName(readCborText(reader)); break;
+        case 2: movie.setYear(int(readCborInteger(reader))); break;
+        case 3: movie.setDirector(readCborText(reader)); break;
+        case 4:
+            movie.m_dateAdded = reader.isInteger() ? kCborEpoch.addDays(qint64(reader.toInteger())) : QDate();
+            reader.next();
+            break;
+        case 5: movie.setNotes(readCborText(reader)); break;
+        case 6:
+            movie.setFavorite(reader.isBool() && reader.toBool());
+            reader.next();
+            break;
+        default: reader.next(); break;
+        }
+    }
+    reader.leaveContainer();
+    return movie;
+}
@@ -0,0 +1,442 @@
+// ============== MovieCsv.cpp ==============
+#include "moviecsv.h"
+#include <QFile>
+#include <QThread>
+#include <QThreadPool>
+#include <QtAlgorithms>
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+// Inputs smaller than this are parsed on the calling thread
+const qsizetype kParallelThreshold = 4 * 1024 * 1024;
+const qsizetype kWriteBufferSize = 1024 * 1024;
+const int kMaxFields = 16;
+
+// ---- SWAR helpers: test 8 bytes per step for the few bytes the parser cares about
+
+quint64 load64(const char* p) {
+    quint64 word;
+    std::memcpy(&word, p, sizeof(word));
+    return word;
+}
+
+// 0x80 in every byte of word that equals c, 0 elsewhere (exact, no false positives)
+quint64 bytesEqual(quint64 word, char c) {
+    const quint64 low7 = 0x7f7f7f7f7f7f7f7full;
+    const quint64 t = word ^ (0x0101010101010101ull * uchar(c));
+    return ~(((t & low7) + low7) | t | low7);
+}
+
+// First comma, CR or LF at or after p (end if none)
+const char* findPlainEnd(const char* p, const char* end) {
+    while (end - p >= 8) {
+        const quint64 word = load64(p);
+        if (bytesEqual(word, ',') | bytesEqual(word, '\n') | bytesEqual(word, '\r')) {
+            break; // the byte loop below finds which one
+        }
+        p += 8;
+    }
+    while (p < end && *p != ',' && *p != '\n' && *p != '\r') {
+        ++p;
+    }
+    return p;
+}
+
+const char* findQuote(const char* p, const char* end) {
+    while (end - p >= 8) {
+        if (bytesEqual(load64(p), '"')) {
+            break;
+        }
+        p += 8;
+    }
+    while (p < end && *p != '"') {
+        ++p;
+    }
+    return p;
+}
+
+qint64 countQuotes(const char* p, const char* end) {
+    qint64 count = 0;
+    while (end - p >= 8) {
+        count += qPopulationCount(bytesEqual(load64(p), '"'));
+        p += 8;
+    }
+    for (; p < end; ++p) {
+        count += *p == '"' ? 1 : 0;
+    }
+    return count;
+}
+
+// ---- Records
+
+struct Field {
+    const char* data = nullptr;
+    qsizetype size = 0;
+    bool escaped = false; // contains doubled quotes to collapse
+};
+
+struct Record {
+    Field fields[kMaxFields];
+    int count = 0;  // fields seen, may exceed kMaxFields (the extra ones are dropped)
+};
+
+// Parses one record starting at p; returns the position after its line break
+const char* parseRecordAt(const char* p, const char* end, Record& record) {
+    record.count = 0;
+    while (true) {
+        Field field;
+        if (p < end && *p == '"') {
+            ++p;
+            field.data = p;
+            while (true) {
+                p = findQuote(p, end);
+                if (p + 1 < end && p[1] == '"') {
+                    field.escaped = true;
+                    p += 2;
+                    continue;
+                }
+                break;
+            }
+            field.size = p - field.data;
+            if (p < end) {
+                ++p; // closing quote
+            }
+            // Tolerate stray characters between the closing quote and the delimiter
+            p = findPlainEnd(p, end);
+        } else {
+            field.data = p;
+            p = findPlainEnd(p, end);
+            field.size = p - field.data;
+        }
+        if (record.count < kMaxFields) {
+            record.fields[record.count] = field;
+        }
+        ++record.count;
+        if (p < end && *p == ',') {
+            ++p;
+            continue;
+        }
+        if (p < end && *p == '\r') {
+            ++p;
+        }
+        if (p < end && *p == '\n') {
+            ++p;
+        }
+        return p;
+    }
+}
+
+QString fieldText(const Field& field) {
+    if (!field.escaped) {
+        return QString::fromUtf8(field.data, field.size).trimmed();
+    }
+    QByteArray bytes(field.data, field.size);
+    bytes.replace("\"\"", "\"");
+    return QString::fromUtf8(bytes).trimmed();
+}
+
+QByteArray fieldBytes(const Field& field) {
+    return QByteArray::fromRawData(field.data, field.size).trimmed();
+}
+
+QDate fieldDate(const Field& field) {
+    const QByteArray text = fieldBytes(field);
+    if (text.size() != 10 || text[4] != '-' || text[7] != '-') {
+        return QDate();
+    }
+    int parts[3] = {0, 0, 0};
+    const int starts[3] = {0, 5, 8};
+    const int lengths[3] = {4, 2, 2};
+    for (int part = 0; part < 3; ++part) {
+        for (int i = starts[part]; i < starts[part] + lengths[part]; ++i) {
+            if (text[i] < '0' || text[i] > '9') {
+                return QDate();
+            }
+            parts[part] = parts[part] * 10 + (text[i] - '0');
+        }
+    }
+    return QDate(parts[0], parts[1], parts[2]);
+}
+
+bool fieldFlag(const Field& field) {
+    const QByteArray text = fieldBytes(field).toLower();
+    return text == "1" || text == "true" || text == "yes" || text == "y";
+}
+
+// Field index of every column, -1 when the file doesn't have it
+struct Layout {
+    int name = 0;
+    int year = 1;
+    int director = 2;
+    int dateAdded = 3;
+    int notes = 4;
+    int favorite = 5;
+
+    static Layout legacy() {
+        Layout layout;
+        layout.director = -1;
+        layout.dateAdded = 2;
+        layout.notes = 3;
+        layout.favorite = 4;
+        return layout;
+    }
+
+    static Layout forFieldCount(int count) { return count >= 6 ? Layout() : legacy(); }
+
+    // Returns false if the record does not look like a header row
+    static bool fromHeader(const Record& record, Layout& layout) {
+        Layout named;
+        named.name = named.year = named.director = named.dateAdded = named.notes = named.favorite = -1;
+        const int fields = qMin(record.count, kMaxFields);
+        for (int i = 0; i < fields; ++i) {
+            const QByteArray name = fieldBytes(record.fields[i]).toLower();
+            if (name == "movie name" || name == "name") named.name = i;
+            else if (name == "year") named.year = i;
+            else if (name == "director") named.director = i;
+            else if (name == "date added" || name == "date_added") named.dateAdded = i;
+            else if (name == "notes") named.notes = i;
+            else if (name == "is favorite" || name == "is_favorite") named.favorite = i;
+        }
+        if (named.name < 0 || named.year < 0) {
+            return false;
+        }
+        layout = named;
+        return true;
+    }
+};
+
+Movie toMovie(const Record& record, const Layout& layout) {
+    static const Field empty;
+    auto field = [&record](int index) -> const Field& {
+        return index >= 0 && index < qMin(record.count, kMaxFields) ? record.fields[index] : empty;
+    };
+    Movie movie(fieldText(field(layout.name)), fieldBytes(field(layout.year)).toInt(),
+                fieldText(field(layout.director)), fieldText(field(layout.notes)),
+                fieldFlag(field(layout.favorite)));
+    movie.setDateAdded(fieldDate(field(layout.dateAdded)));
+    return movie;
+}
+
+bool isBlank(const Record& record) {
+    return record.count == 1 && record.fields[0].size == 0;
+}
+
+void parseRange(const char* p, const char* end, const Layout& layout, MovieStore& out) {
+    Record record;
+    while (p < end) {
+        p = parseRecordAt(p, end, record);
+        if (!isBlank(record)) {
+            out.append(toMovie(record, layout));
+        }
+    }
+}
+
+// ---- Writing
+
+bool needsQuotes(QStringView text) {
+    for (QChar c : text) {
+        if (c == QLatin1Char(',') || c == QLatin1Char('"') || c == QLatin1Char('\n') || c == QLatin1Char('\r')) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void appendQuoted(QByteArray& out, QStringView text) {
+    out += '"';
+    QByteArray utf8 = text.toUtf8();
+    if (utf8.contains('"')) {
+        utf8.replace("\"", "\"\"");
+    }
+    out += utf8;
+    out += '"';
+}
+
+void appendFields(QByteArray& out, QStringView name, int year, QStringView director, const QDate& dateAdded,
+                  QStringView notes, bool favorite) {
+    // Same shape as the existing files: name bare unless it has to be quoted, director and notes always quoted
+    if (needsQuotes(name)) {
+        appendQuoted(out, name);
+    } else {
+        out += name.toUtf8();
+    }
+    out += ',';
+    out += QByteArray::number(year);
+    out += ',';
+    appendQuoted(out, director);
+    out += ',';
+    out += dateAdded.toString("yyyy-MM-dd").toLatin1();
+    out += ',';
+    appendQuoted(out, notes);
+    out += favorite ? ",1" : ",0";
+}
+
+} // namespace
+
+bool MovieCsv::parse(const char* data, qsizetype size, MovieStore& out, QString* error) {
+    Q_UNUSED(error)
+    const char* begin = data;
+    const char* end = data + size;
+    if (size >= 3 && std::memcmp(begin, "\xEF\xBB\xBF", 3) == 0) {
+        begin += 3; // UTF-8 BOM from spreadsheet exports
+    }
+
+    // The first record decides the layout: a header names the columns, otherwise the field count does
+    Record first;
+    const char* afterFirst = parseRecordAt(begin, end, first);
+    Layout layout;
+    if (Layout::fromHeader(first, layout)) {
+        begin = afterFirst;
+    } else {
+        layout = Layout::forFieldCount(first.count);
+    }
+
+    const int threads = QThread::idealThreadCount();
+    if (end - begin < kParallelThreshold || threads < 2) {
+        parseRange(begin, end, layout, out);
+        return true;
+    }
+
+    // Cut into chunks. A quote count per chunk (parallel) tells whether each nominal cut
+    // falls inside a quoted field, so the real cut can move to the next record boundary.
+    const int chunks = threads * 4;
+    const qsizetype span = end - begin;
+    QVector<const char*> cuts(chunks + 1);
+    for (int i = 0; i <= chunks; ++i) {
+        cuts[i] = begin + span * i / chunks;
+    }
+    QVector<qint64> quotes(chunks);
+    QThreadPool pool;
+    pool.setMaxThreadCount(threads);
+    for (int i = 0; i < chunks; ++i) {
+        pool.start([&quotes, &cuts, i]() { quotes[i] = countQuotes(cuts[i], cuts[i + 1]); });
+    }
+    pool.waitForDone();
+
+    QVector<const char*> starts(chunks + 1);
+    starts[0] = begin;
+    starts[chunks] = end;
+    qint64 quotesBefore = 0;
+    for (int i = 1; i < chunks; ++i) {
+        quotesBefore += quotes[i - 1];
+        bool inQuotes = quotesBefore % 2 != 0;
+        const char* p = cuts[i];
+        while (p < end && (inQuotes || *p != '\n')) {
+            inQuotes ^= *p == '"';
+            ++p;
+        }
+        starts[i] = qMax(starts[i - 1], p < end ? p + 1 : end);
+    }
+
+    QVector<MovieStore> parts(chunks);
+    for (int i = 0; i < chunks; ++i) {
+        pool.start([&parts, &starts, &layout, i]() { parseRange(starts[i], starts[i + 1], layout, parts[i]); });
+    }
+    pool.waitForDone();
+
+    int rows = out.size();
+    for (const MovieStore& part : parts) {
+        rows += part.size();
+    }
+    out.reserve(rows);
+    for (MovieStore& part : parts) {
+        out.append(part);
+        part.clear(); // release each chunk as soon as it is merged
+    }
+    return true;
+}
+
+bool MovieCsv::readFile(const QString& path, MovieStore& out, QString* error) {
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        if (error) *error = file.errorString();
+        return false;
+    }
+    if (file.size() == 0) {
+        return true;
+    }
+    // Mapped pages are read straight from the page cache; nothing is copied up front
+    const uchar* data = file.map(0, file.size());
+    if (data) {
+        return parse(reinterpret_cast<const char*>(data), file.size(), out, error);
+    }
+    const QByteArray contents = file.readAll();
+    return parse(contents.constData(), contents.size(), out, error);
+}
+
+bool MovieCsv::parseRecord(const QByteArray& record, Movie& movie) {
+    Record parsed;
+    parseRecordAt(record.constData(), record.constData() + record.size(), parsed);
+    if (parsed.count < 5) {
+        return false;
+    }
+    movie = toMovie(parsed, Layout::forFieldCount(parsed.count));
+    return true;
+}
+
+QByteArray MovieCsv::header() {
+    return QByteArrayLiteral("Movie Name,Year,Director,Date Added,Notes,Is Favorite");
+}
+
+void MovieCsv::appendRecord(QByteArray& out, const Movie& movie) {
+    appendFields(out, movie.getName(), movie.getYear(), movie.getDirector(), movie.getDateAdded(),
+                 movie.getNotes(), movie.isFavorite());
+}
+
+void MovieCsv::appendRecord(QByteArray& out, const MovieStore& store, int row) {
+    appendFields(out, store.name(row), store.year(row), store.director(row), store.dateAdded(row),
+                 store.notes(row), store.isFavorite(row));
+}
+
+MovieCsv::Writer::Writer(const QString& path) : m_file(path) {}
+
+bool MovieCsv::Writer::open(bool withHeader) {
+    if (!m_file.open(QIODevice::WriteOnly)) {
+        m_failed = true;
+        return false;
+    }
+    m_buffer.reserve(kWriteBufferSize + 4096);
+    if (withHeader) {
+        m_buffer += header();
+        m_buffer += '\n';
+    }
+    return true;
+}
+
+void MovieCsv::Writer::write(const Movie& movie) {
+    appendRecord(m_buffer, movie);
+    m_buffer += '\n';
+    flushIfFull();
+}
+
+void MovieCsv::Writer::write(const MovieStore& store, int row) {
+    appendRecord(m_buffer, store, row);
+    m_buffer += '\n';
+    flushIfFull();
+}
+
+void MovieCsv::Writer::flushIfFull() {
+    // Memory stays at one buffer no matter how many rows go through
+    if (m_buffer.size() < kWriteBufferSize) {
+        return;
+    }
+    if (!m_failed && m_file.write(m_buffer) != m_buffer.size()) {
+        m_failed = true;
+    }
+    m_buffer.resize(0); // keeps the allocation for the next batch of rows
+}
+
+bool MovieCsv::Writer::commit() {
+    if (!m_failed && !m_buffer.isEmpty() && m_file.write(m_buffer) != m_buffer.size()) {
+        m_failed = true;
+    }
+    m_buffer.clear();
+    if (m_failed) {
+        m_file.cancelWriting();
+        m_file.commit();
+        return false;
+    }
+    return m_file.commit();
+}
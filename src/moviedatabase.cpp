@@ -1,209 +1,1693 @@
-
 // ============== MovieDatabase.cpp ==============
 #include "moviedatabase.h"
+#include "moviejsonstream.h"
+#include "snapshotfile.h"
+#include "tracing.h"
+#include <QCryptographicHash>
 #include <QFile>
 #include <QTextStream>
 #include <QDir>
+#include <QFileInfo>
 #include <QDebug>
 #include <QNetworkRequest>
 #include <QJsonDocument>
 #include <QJsonArray>
+#include <QCborStreamReader>
+#include <QElapsedTimer>
 #include <QEventLoop>
+#include <QMetaEnum>
 #include <QTimer>
+#include <QUrlQuery>
+#include <QStandardPaths>
+#include <QThreadPool>
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <memory>
+#include <numeric>
 
-MovieDatabase::MovieDatabase(const QString& apiBaseUrl) : m_apiBaseUrl(apiBaseUrl) {}
+namespace {
 
-bool MovieDatabase::loadFromApi() {
-    clearError();
-    QNetworkRequest req(QUrl(m_apiBaseUrl + "/movies"));
-    req.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
-    QNetworkReply* reply = m_network.get(req);
-    QEventLoop loop;
-    QObject::connect(reply, &QNetworkReply::finished, &loop, &QEventLoop::quit);
-    loop.exec();
-    if (reply->error() != QNetworkReply::NoError) {
-        setError(reply->errorString());
-        reply->deleteLater();
+const QLatin1String kCborMediaType("application/cbor");
+const int kReplayBatchSize = 100; // journal entries per /movies/batch while replaying
+const int kMaxBatchOperations = 1000; // the backend refuses larger batches as a whole (422)
+
+bool isCborReply(QNetworkReply* reply) {
+    return reply->header(QNetworkRequest::ContentTypeHeader).toString().startsWith(kCborMediaType);
+}
+
+// True when a server row holds what movie would have been stored as (the backend trims text)
+bool storedAs(const Movie& row, const Movie& movie) {
+    return row.getName() == movie.getName().trimmed() && row.getYear() == movie.getYear()
+        && row.getDirector() == movie.getDirector().trimmed() && row.getDateAdded() == movie.getDateAdded()
+        && row.getNotes() == movie.getNotes().trimmed() && row.isFavorite() == movie.isFavorite();
+}
+
+// One file per backend, so pointing the app at another server never mixes in state from the first
+QString localDataPath(const QString& apiBaseUrl, const QString& extension) {
+    const QByteArray key = QCryptographicHash::hash(apiBaseUrl.toUtf8(), QCryptographicHash::Sha1).toHex().left(12);
+    const QString dir = QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation);
+    return dir + "/movies-" + QString::fromLatin1(key) + "." + extension;
+}
+
+// Body of GET /movies/changes, in either wire format
+struct ChangeSet {
+    qint64 revision = -1;
+    QVector<qint64> deletes;
+    QVector<Movie> upserts;
+};
+
+bool parseChangesJson(const QByteArray& data, qint64 fallbackRevision, ChangeSet& changes) {
+    QJsonDocument doc = QJsonDocument::fromJson(data);
+    if (!doc.isObject()) {
         return false;
     }
-    const QByteArray data = reply->readAll();
-    reply->deleteLater();
-    QJsonParseError parseError;
-    QJsonDocument doc = QJsonDocument::fromJson(data, &parseError);
-    if (parseError.error != QJsonParseError::NoError || !doc.isArray()) {
-        setError("Invalid response from API");
-        return false;
+    const QJsonObject obj = doc.object();
+    changes.revision = obj.value("revision").toInteger(fallbackRevision);
+    const QJsonArray deletes = obj.value("deletes").toArray();
+    for (const QJsonValue& val : deletes) {
+        changes.deletes.append(val.toInteger());
     }
-    m_movies.clear();
-    for (const QJsonValue& val : doc.array()) {
+    const QJsonArray upserts = obj.value("upserts").toArray();
+    for (const QJsonValue& val : upserts) {
         if (val.isObject()) {
-            m_movies.append(Movie::fromJson(val.toObject()));
+            changes.upserts.append(Movie::fromJson(val.toObject()));
         }
     }
-    qDebug() << "Loaded" << m_movies.size() << "movies from API";
     return true;
 }
 
-// removed CSV saving in API mode
+bool parseChangesCbor(const QByteArray& data, qint64 fallbackRevision, ChangeSet& changes) {
+    QCborStreamReader reader(data);
+    if (!reader.isMap() || !reader.enterContainer()) {
+        return false;
+    }
+    changes.revision = fallbackRevision;
+    while (reader.lastError() == QCborError::NoError && reader.hasNext()) {
+        if (!reader.isString()) {
+            return false;
+        }
+        QString key;
+        auto chunk = reader.readString();
+        while (chunk.status == QCborStreamReader::Ok) {
+            key += chunk.data;
+            chunk = reader.readString();
+        }
+        if (key == QLatin1String("revision") && reader.isInteger()) {
+            changes.revision = qint64(reader.toInteger());
+            reader.next();
+        } else if (key == QLatin1String("deletes") && reader.isArray() && reader.enterContainer()) {
+            while (reader.lastError() == QCborError::NoError && reader.hasNext()) {
+                if (reader.isInteger()) {
+                    changes.deletes.append(qint64(reader.toInteger()));
+                }
+                reader.next();
+            }
+            reader.leaveContainer();
+        } else if (key == QLatin1String("upserts") && reader.isArray() && reader.enterContainer()) {
+            while (reader.lastError() == QCborError::NoError && reader.hasNext()) {
+                changes.upserts.append(Movie::fromCbor(reader));
+            }
+            reader.leaveContainer();
+        } else {
+            reader.next();
+        }
+    }
+    reader.leaveContainer();
+    return reader.lastError() == QCborError::NoError;
+}
 
-bool MovieDatabase::addMovie(const Movie& movie) {
-    clearError();
-    QNetworkRequest req(QUrl(m_apiBaseUrl + "/movies"));
+// Body of GET /movies as CBOR: an array of positional records, decoded straight into the store
+bool readMoviesCbor(const QByteArray& data, MovieStore& store) {
+    QCborStreamReader reader(data);
+    if (!reader.isArray() || !reader.enterContainer()) {
+        return false;
+    }
+    if (reader.isLengthKnown()) {
+        store.reserve(int(reader.length()));
+    }
+    while (reader.lastError() == QCborError::NoError && reader.hasNext()) {
+        store.append(Movie::fromCbor(reader));
+    }
+    reader.leaveContainer();
+    return reader.lastError() == QCborError::NoError;
+}
+
+// Scans larger than this are split across the scan pool
+const int kParallelScanRows = 50000;
+const int kMinScanChunk = 16384;
+
+} // namespace
+
+// Row test for one query over one store. It keeps its own (shared) copy of the
+// store, so query() and the parallel scans on worker threads use the same code.
+class MovieDatabase::QueryMatcher {
+public:
+    QueryMatcher(const MovieStore& store, const MovieQuery& query, int scannedRows)
+        : m_store(store), m_query(query) {
+        // Director names are interned, so for large scans the director test is
+        // evaluated once per distinct director instead of once per row
+        const QStringList& directors = m_store.directorNames();
+        m_useDirectorDictionary = !m_query.directorContains.isEmpty() && directors.size() < scannedRows;
+        if (m_useDirectorDictionary) {
+            m_directorMatches.resize(directors.size());
+            for (int id = 0; id < directors.size(); ++id) {
+                m_directorMatches.setBit(id, directors[id].contains(m_query.directorContains, Qt::CaseInsensitive));
+            }
+        }
+        m_fromDay = m_query.addedFrom.isValid() ? MovieStore::dayNumber(m_query.addedFrom) : MovieStore::NoDay;
+        m_toDay = m_query.addedTo.isValid() ? MovieStore::dayNumber(m_query.addedTo)
+                                            : std::numeric_limits<qint32>::max();
+    }
+
+    // Cheapest column tests first; string data is only touched by rows that get that far
+    bool matches(int row) const {
+        if (m_query.favoritesOnly && !m_store.isFavorite(row)) {
+            return false;
+        }
+        const qint32 day = m_store.day(row);
+        if (day < m_fromDay || day > m_toDay) {
+            return false;
+        }
+        if (!m_query.directorContains.isEmpty()) {
+            const bool directorOk = m_useDirectorDictionary
+                ? m_directorMatches.testBit(m_store.directorId(row))
+                : m_store.director(row).contains(m_query.directorContains, Qt::CaseInsensitive);
+            if (!directorOk) {
+                return false;
+            }
+        }
+        return m_query.nameContains.isEmpty() || m_store.name(row).contains(m_query.nameContains, Qt::CaseInsensitive);
+    }
+
+private:
+    MovieStore m_store;
+    MovieQuery m_query;
+    QBitArray m_directorMatches;
+    bool m_useDirectorDictionary;
+    qint32 m_fromDay;
+    qint32 m_toDay;
+};
+
+MovieDatabase::MovieDatabase(const QString& apiBaseUrl, QObject* parent)
+    : QObject(parent), m_revision(-1), m_apiBaseUrl(apiBaseUrl), m_preferCbor(false), m_pendingRequests(0),
+      m_coalesceWindowMs(0), m_coalesceMaxBatch(50), m_replayBackoffMs(1000), m_replaying(false),
+      m_replayBatches(true), m_refreshing(false), m_refreshIsLoad(false), m_confirmedWrites(0) {
+    m_flushTimer.setSingleShot(true);
+    connect(&m_flushTimer, &QTimer::timeout, this, &MovieDatabase::flushWrites);
+    m_replayTimer.setSingleShot(true);
+    connect(&m_replayTimer, &QTimer::timeout, this, &MovieDatabase::replayJournal);
+
+    m_metrics.describe("movie_api_request_duration_seconds", "Time from sending a request to its last byte, by endpoint.");
+    m_metrics.describe("movie_api_errors_total", "Failed requests by endpoint and QNetworkReply error.");
+    m_metrics.describe("movie_api_bytes_sent_total", "Request body bytes sent.");
+    m_metrics.describe("movie_api_bytes_received_total", "Response body bytes received.");
+    m_metrics.describe("movie_operation_duration_seconds", "Time from calling an operation to its completion.");
+    m_metrics.describe("movie_operation_failures_total", "Operations that completed with an error.");
+    m_metrics.describe("movie_collection_size", "Movies in the local collection.");
+    m_metrics.describe("movie_search_duration_seconds", "Local search time, by kind of search.");
+    m_metrics.describe("movie_sort_duration_seconds", "Time to order a set of rows.");
+    m_bytesSent = m_metrics.counter("movie_api_bytes_sent_total");
+    m_bytesReceived = m_metrics.counter("movie_api_bytes_received_total");
+    m_collectionSize = m_metrics.gauge("movie_collection_size");
+    m_queryDuration = m_metrics.histogram("movie_search_duration_seconds", Metrics::label("kind", "query"));
+    m_scanDuration = m_metrics.histogram("movie_search_duration_seconds", Metrics::label("kind", "scan"));
+    m_fuzzyQueryDuration = m_metrics.histogram("movie_search_duration_seconds", Metrics::label("kind", "fuzzy"));
+    m_textQueryDuration = m_metrics.histogram("movie_search_duration_seconds", Metrics::label("kind", "text"));
+    m_sortDuration = m_metrics.histogram("movie_sort_duration_seconds");
+}
+
+MovieDatabase::~MovieDatabase() {
+    // Let running scans bail out, and don't destroy anything they still read
+    cancelScans();
+    m_scanPool.waitForDone();
+}
+
+QNetworkRequest MovieDatabase::jsonRequest(const QString& path) const {
+    QNetworkRequest req(QUrl(m_apiBaseUrl + path));
     req.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
+    return req;
+}
+
+QNetworkRequest MovieDatabase::readRequest(const QString& path) const {
+    QNetworkRequest req = jsonRequest(path);
+    if (m_preferCbor) {
+        // Servers without CBOR support ignore this and answer with JSON, which is handled as before
+        req.setRawHeader("Accept", "application/cbor, application/json;q=0.5");
+    }
+    return req;
+}
+
+void MovieDatabase::onReply(QNetworkReply* reply, std::function<void(QNetworkReply*)> handler) {
+    ++m_pendingRequests;
+    // Every request passes through here, so one async span and one latency sample cover send to last byte
+    static const char* const methods[] = {"?", "HEAD", "GET", "PUT", "POST", "DELETE", "CUSTOM"};
+    const int operation = reply->operation();
+    const QString method = QLatin1String(methods[operation < 7 ? operation : 0]);
+    quint64 traceId = 0;
+    if (Trace::isEnabled()) {
+        traceId = Trace::nextAsyncId();
+        Trace::asyncBegin("HTTP request", traceId,
+                          method + ' ' + reply->url().toString(QUrl::RemoveScheme | QUrl::RemoveAuthority));
+    }
+    const QString endpoint = Metrics::label("endpoint", method + ' ' + reply->url().path());
+    MetricHistogram* duration = m_metrics.histogram("movie_api_request_duration_seconds", endpoint);
+    QElapsedTimer timer;
+    timer.start();
+    // Progress signals report running totals; the last value is the body size
+    auto sent = std::make_shared<qint64>(0);
+    auto received = std::make_shared<qint64>(0);
+    connect(reply, &QNetworkReply::uploadProgress, this, [sent](qint64 bytes, qint64) { *sent = bytes; });
+    connect(reply, &QNetworkReply::downloadProgress, this, [received](qint64 bytes, qint64) { *received = bytes; });
+
+    connect(reply, &QNetworkReply::finished, this,
+            [this, reply, handler, traceId, endpoint, duration, timer, sent, received]() {
+        --m_pendingRequests;
+        if (traceId != 0) {
+            Trace::asyncEnd("HTTP request", traceId, "status",
+                            reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt());
+        }
+        duration->record(timer.nsecsElapsed());
+        m_bytesSent->add(quint64(qMax<qint64>(0, *sent)));
+        m_bytesReceived->add(quint64(qMax<qint64>(0, *received)));
+        if (reply->error() != QNetworkReply::NoError) {
+            const char* key = QMetaEnum::fromType<QNetworkReply::NetworkError>().valueToKey(reply->error());
+            const QString error = key ? QString::fromLatin1(key) : QString::number(reply->error());
+            m_metrics.counter("movie_api_errors_total", Metrics::labels(endpoint, Metrics::label("error", error)))->add();
+        }
+        TRACE_SCOPE("MovieDatabase::handleReply");
+        handler(reply);
+        reply->deleteLater();
+    });
+}
+
+MovieDatabase::Completion MovieDatabase::timed(const QString& operation, Completion done) {
+    // What the caller waits for: queueing, retries and fallbacks included
+    const QString labels = Metrics::label("operation", operation);
+    MetricHistogram* duration = m_metrics.histogram("movie_operation_duration_seconds", labels);
+    QElapsedTimer timer;
+    timer.start();
+    return [this, labels, duration, timer, done](bool ok, const QString& error) {
+        duration->record(timer.nsecsElapsed());
+        if (!ok) {
+            m_metrics.counter("movie_operation_failures_total", labels)->add();
+        }
+        if (done) {
+            done(ok, error);
+        }
+    };
+}
+
+void MovieDatabase::complete(const Completion& done, bool ok, const QString& error) {
+    if (ok) {
+        clearError();
+    } else {
+        setError(error);
+    }
+    if (done) {
+        done(ok, error);
+    }
+}
+
+bool MovieDatabase::runBlocking(const std::function<void(Completion)>& start) {
+    bool finished = false;
+    bool result = false;
+    QEventLoop loop;
+    start([&](bool ok, const QString&) {
+        result = ok;
+        finished = true;
+        loop.quit();
+    });
+    if (!finished) {
+        loop.exec();
+    }
+    return result;
+}
+
+void MovieDatabase::fetchMovieListAsync(const QString& path, ListHandler handler) {
+    QNetworkReply* reply = m_network.get(readRequest(path));
+    // JSON is decoded chunk by chunk as it arrives instead of buffering the whole body for a QJsonDocument
+    auto stream = std::make_shared<MovieJsonStream>();
+    connect(reply, &QNetworkReply::readyRead, this, [reply, stream]() {
+        if (isCborReply(reply)) {
+            return; // compact enough to decode in one go when finished
+        }
+        const int status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+        if (status < 200 || status >= 300) {
+            return; // an error body ({"detail": ...}) is not a movie list; the status says what went wrong
+        }
+        TRACE_SCOPE("MovieJsonStream::feed");
+        if (!stream->feed(reply->readAll())) {
+            reply->abort(); // no point downloading the rest of a malformed body
+        }
+    });
+    onReply(reply, [handler, stream](QNetworkReply* reply) {
+        TraceSpan span("MovieDatabase::decodeMovieList");
+        MovieStore store;
+        // A malformed body is aborted above, which the reply reports as canceled; anything else is the server's error
+        const bool abortedByStream = stream->hasError() && reply->error() == QNetworkReply::OperationCanceledError;
+        if (reply->error() != QNetworkReply::NoError && !abortedByStream) {
+            handler(reply, store, reply->errorString());
+            return;
+        }
+        if (stream->hasError()) {
+            handler(reply, store, stream->errorString());
+            return;
+        }
+        if (isCborReply(reply)) {
+            if (!readMoviesCbor(reply->readAll(), store)) {
+                handler(reply, store, "Invalid response from API");
+                return;
+            }
+        } else {
+            stream->feed(reply->readAll());
+            if (!stream->finish()) {
+                handler(reply, store, stream->errorString());
+                return;
+            }
+            store = stream->takeStore();
+        }
+        span.setArg("movies", store.size());
+        handler(reply, store, QString());
+    });
+}
+
+void MovieDatabase::loadFromApiAsync(Completion done) {
+    refreshAsync(true, timed("loadFromApi", std::move(done)));
+}
+
+void MovieDatabase::syncFromApiAsync(Completion done) {
+    refreshAsync(false, timed("syncFromApi", std::move(done)));
+}
+
+void MovieDatabase::refreshAsync(bool fullLoad, Completion done) {
+    if (m_refreshing && fullLoad && !m_refreshIsLoad) {
+        // A sync can't stand in for a full reload (e.g. after a rejected write): run one when it is done
+        m_queuedLoadWaiters.append(done);
+        return;
+    }
+    m_refreshWaiters.append(done);
+    if (m_refreshing) {
+        return; // the load or sync in flight answers this caller too
+    }
+    m_refreshing = true;
+    m_refreshIsLoad = false;
+    if (fullLoad || m_revision < 0) {
+        refreshLoad();
+    } else {
+        refreshChanges(m_revision, nullptr);
+    }
+}
+
+void MovieDatabase::finishRefresh(bool ok, const QString& error) {
+    const QVector<Completion> waiters = m_refreshWaiters;
+    m_refreshWaiters = m_queuedLoadWaiters;
+    m_queuedLoadWaiters.clear();
+    m_refreshing = !m_refreshWaiters.isEmpty();
+    if (m_refreshing) {
+        refreshLoad();
+    }
+    for (const Completion& done : waiters) {
+        complete(done, ok, error);
+    }
+}
+
+void MovieDatabase::refreshLoad() {
+    m_refreshIsLoad = true;
+    const quint64 writes = m_confirmedWrites;
+    fetchMovieListAsync("/movies", [this, writes](QNetworkReply* reply, const MovieStore& store, const QString& error) {
+        if (!error.isEmpty()) {
+            finishRefresh(false, error);
+            return;
+        }
+        const QByteArray revisionHeader = reply->rawHeader("X-Movies-Revision");
+        if (writes != m_confirmedWrites && !revisionHeader.isEmpty()) {
+            // Writes confirmed while the list was on its way may be missing from it;
+            // fetch them before the list replaces the collection
+            refreshChanges(revisionHeader.toLongLong(), std::make_shared<const MovieStore>(store));
+            return;
+        }
+        resetStore(store);
+        // Older backends don't send a cursor; 0 makes the next sync return everything
+        m_revision = revisionHeader.isEmpty() ? 0 : revisionHeader.toLongLong();
+        qDebug() << "Loaded" << m_store.size() << "movies from API";
+        saveSnapshotAsync();
+        reapplyJournal(); // unconfirmed local writes stay visible
+        emit moviesChanged();
+        finishRefresh(true);
+    });
+}
+
+void MovieDatabase::refreshChanges(qint64 since, std::shared_ptr<const MovieStore> base) {
+    const quint64 writes = m_confirmedWrites;
+    QNetworkReply* reply = m_network.get(readRequest("/movies/changes?since=" + QString::number(since)));
+    onReply(reply, [this, since, base, writes](QNetworkReply* reply) {
+        if (reply->error() == QNetworkReply::ContentNotFoundError && !base) {
+            // Backend without /movies/changes: fall back to a full reload
+            refreshLoad();
+            return;
+        }
+        if (reply->error() != QNetworkReply::NoError) {
+            finishRefresh(false, reply->errorString());
+            return;
+        }
+        ChangeSet changes;
+        bool parsed = false;
+        {
+            TRACE_SCOPE("MovieDatabase::decodeChanges");
+            parsed = isCborReply(reply) ? parseChangesCbor(reply->readAll(), since, changes)
+                                        : parseChangesJson(reply->readAll(), since, changes);
+        }
+        if (!parsed) {
+            finishRefresh(false, "Invalid response from API");
+            return;
+        }
+        if (changes.revision < since) {
+            // The backend went back in time (restored or recreated database), so our cursor means nothing
+            refreshLoad();
+            return;
+        }
+        TraceSpan span("MovieDatabase::applyChanges");
+        span.setArg("changes", changes.deletes.size() + changes.upserts.size());
+        if (base) {
+            resetStore(*base);
+        }
+        // Deletes first: an id can be deleted and then reused by a newer row
+        for (qint64 id : changes.deletes) {
+            const int row = m_rowById.value(id, -1);
+            if (row >= 0) {
+                removeRow(row);
+            }
+        }
+        for (const Movie& movie : changes.upserts) {
+            upsertById(movie);
+        }
+        m_revision = changes.revision;
+        if (base || !changes.deletes.isEmpty() || !changes.upserts.isEmpty()) {
+            saveSnapshotAsync();
+            reapplyJournal(); // server rows may have overwritten unconfirmed local writes
+            emit moviesChanged();
+        }
+        if (writes != m_confirmedWrites) {
+            // A write confirmed meanwhile may have been answered after these changes were
+            // read, and one of them may be an older copy of its row: go again from here
+            refreshChanges(m_revision, nullptr);
+            return;
+        }
+        finishRefresh(true);
+    });
+}
+
+void MovieDatabase::fetchPageAsync(const MovieQuery& query, SortKey key, bool descending,
+                                   const QString& cursor, int limit, PageCompletion done) {
+    static const char* const sortNames[] = {"date", "name", "year"};
+    QUrlQuery params;
+    if (!query.nameContains.isEmpty()) params.addQueryItem("name", query.nameContains);
+    if (!query.directorContains.isEmpty()) params.addQueryItem("director", query.directorContains);
+    if (query.addedFrom.isValid()) params.addQueryItem("added_from", query.addedFrom.toString("yyyy-MM-dd"));
+    if (query.addedTo.isValid()) params.addQueryItem("added_to", query.addedTo.toString("yyyy-MM-dd"));
+    if (query.favoritesOnly) params.addQueryItem("favorites", "true");
+    params.addQueryItem("sort", QString("%1_%2").arg(sortNames[key], descending ? "desc" : "asc"));
+    params.addQueryItem("limit", QString::number(limit));
+    if (!cursor.isEmpty()) params.addQueryItem("after", cursor);
+    // QUrlQuery leaves '+' alone, which the server would read as a space
+    const QString encoded = params.toString(QUrl::FullyEncoded).replace("+", "%2B");
+
+    fetchMovieListAsync("/movies?" + encoded, [this, done](QNetworkReply* reply, const MovieStore& page, const QString& error) {
+        if (!error.isEmpty()) {
+            setError(error);
+        }
+        if (done) {
+            done(error.isEmpty(), error, page, QString::fromLatin1(reply->rawHeader("X-Next-Cursor")));
+        }
+    });
+}
+
+QJsonObject MovieDatabase::identityKey(const Movie& movie) {
+    QJsonObject key;
+    key["name"] = movie.getName();
+    key["year"] = movie.getYear();
+    key["date_added"] = movie.getDateAdded().toString("yyyy-MM-dd");
+    return key;
+}
+
+QJsonObject MovieDatabase::createBody(const Movie& movie) {
     QJsonObject body = movie.toJson();
     if (body.value("date_added").toString().isEmpty()) {
         body["date_added"] = QDate::currentDate().toString("yyyy-MM-dd");
     }
-    QNetworkReply* reply = m_network.post(req, QJsonDocument(body).toJson());
-    QEventLoop loop;
-    QObject::connect(reply, &QNetworkReply::finished, &loop, &QEventLoop::quit);
-    loop.exec();
-    if (reply->error() != QNetworkReply::NoError) {
-        setError(reply->errorString());
-        reply->deleteLater();
+    return body;
+}
+
+QJsonObject MovieDatabase::batchOperation(WriteJournal::Op op, const Movie& original, const Movie& movie) {
+    QJsonObject operation;
+    switch (op) {
+    case WriteJournal::Create:
+        operation["op"] = "create";
+        operation["movie"] = createBody(movie);
+        break;
+    case WriteJournal::Update:
+        operation["op"] = "update";
+        operation["original"] = identityKey(original);
+        operation["updated"] = movie.toJson();
+        break;
+    case WriteJournal::Delete:
+        operation["op"] = "delete";
+        operation["original"] = identityKey(original);
+        break;
+    }
+    return operation;
+}
+
+bool MovieDatabase::applyUpdated(const Movie& original, const Movie& updated) {
+    // Look the row up now: other requests may have moved it while this one was in flight
+    const int row = findRow(original);
+    if (row < 0) {
         return false;
     }
-    const QByteArray data = reply->readAll();
-    reply->deleteLater();
-    QJsonDocument doc = QJsonDocument::fromJson(data);
-    if (doc.isObject()) {
-        m_movies.append(Movie::fromJson(doc.object()));
-        return true;
+    replaceRow(row, updated);
+    return true;
+}
+
+bool MovieDatabase::applyDeleted(const Movie& movie) {
+    const int row = findRow(movie);
+    if (row < 0) {
+        return false;
     }
-    setError("Invalid response from API");
-    return false;
+    removeRow(row);
+    return true;
 }
 
-bool MovieDatabase::updateMovie(const Movie& original, const Movie& movie) {
-    QNetworkRequest req(QUrl(m_apiBaseUrl + "/movies"));
-    req.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
+void MovieDatabase::addMovieAsync(const Movie& movie, Completion done) {
+    done = timed("addMovie", std::move(done));
+    if (isOptimistic()) {
+        WriteJournal::Entry entry;
+        entry.op = WriteJournal::Create;
+        entry.movie = movie;
+        if (!entry.movie.getDateAdded().isValid()) {
+            entry.movie.setDateAdded(QDate::currentDate()); // what the server would pick, so both sides agree
+        }
+        writeOptimistically(entry, done);
+        return;
+    }
+    if (m_coalesceWindowMs > 0) {
+        enqueueWrite({PendingWrite::Create, Movie(), movie, done});
+        return;
+    }
+    sendCreate(movie, done);
+}
+
+void MovieDatabase::sendCreate(const Movie& movie, const Completion& done) {
+    QNetworkReply* reply = m_network.post(jsonRequest("/movies"), QJsonDocument(createBody(movie)).toJson());
+    onReply(reply, [this, done](QNetworkReply* reply) {
+        if (reply->error() != QNetworkReply::NoError) {
+            complete(done, false, reply->errorString());
+            return;
+        }
+        QJsonDocument doc = QJsonDocument::fromJson(reply->readAll());
+        if (!doc.isObject()) {
+            complete(done, false, "Invalid response from API");
+            return;
+        }
+        ++m_confirmedWrites;
+        insertRow(Movie::fromJson(doc.object()));
+        emit moviesChanged();
+        emit writesConfirmed();
+        complete(done, true);
+    });
+}
+
+void MovieDatabase::updateMovieAsync(const Movie& original, const Movie& movie, Completion done) {
+    done = timed("updateMovie", std::move(done));
+    if (isOptimistic()) {
+        WriteJournal::Entry entry;
+        entry.op = WriteJournal::Update;
+        entry.original = original;
+        entry.movie = movie;
+        writeOptimistically(entry, done);
+        return;
+    }
+    if (m_coalesceWindowMs > 0) {
+        enqueueWrite({PendingWrite::Update, original, movie, done});
+        return;
+    }
+    sendUpdate(original, movie, done);
+}
+
+void MovieDatabase::sendUpdate(const Movie& original, const Movie& movie, const Completion& done) {
     QJsonObject payload;
-    QJsonObject originalKey;
-    originalKey["name"] = original.getName();
-    originalKey["year"] = original.getYear();
-    originalKey["date_added"] = original.getDateAdded().toString("yyyy-MM-dd");
-    payload["original"] = originalKey;
+    payload["original"] = identityKey(original);
     payload["updated"] = movie.toJson();
-    clearError();
-    QNetworkReply* reply = m_network.put(req, QJsonDocument(payload).toJson());
-    QEventLoop loop;
-    QObject::connect(reply, &QNetworkReply::finished, &loop, &QEventLoop::quit);
-    loop.exec();
-    if (reply->error() != QNetworkReply::NoError) {
-        setError(reply->errorString());
-        reply->deleteLater();
+    QNetworkReply* reply = m_network.put(jsonRequest("/movies"), QJsonDocument(payload).toJson());
+    onReply(reply, [this, original, done](QNetworkReply* reply) {
+        if (reply->error() != QNetworkReply::NoError) {
+            complete(done, false, reply->errorString());
+            return;
+        }
+        QJsonDocument doc = QJsonDocument::fromJson(reply->readAll());
+        if (!doc.isObject()) {
+            complete(done, false, "Invalid response from API");
+            return;
+        }
+        ++m_confirmedWrites;
+        if (applyUpdated(original, Movie::fromJson(doc.object()))) {
+            emit moviesChanged();
+        }
+        emit writesConfirmed();
+        complete(done, true);
+    });
+}
+
+void MovieDatabase::deleteMovieAsync(const Movie& movie, Completion done) {
+    done = timed("deleteMovie", std::move(done));
+    if (isOptimistic()) {
+        WriteJournal::Entry entry;
+        entry.op = WriteJournal::Delete;
+        entry.original = movie;
+        writeOptimistically(entry, done);
+        return;
+    }
+    if (m_coalesceWindowMs > 0) {
+        enqueueWrite({PendingWrite::Delete, movie, Movie(), done});
+        return;
+    }
+    sendDelete(movie, done);
+}
+
+void MovieDatabase::sendDelete(const Movie& movie, const Completion& done) {
+    QNetworkReply* reply = m_network.post(jsonRequest("/movies/delete"), QJsonDocument(identityKey(movie)).toJson());
+    onReply(reply, [this, movie, done](QNetworkReply* reply) {
+        if (reply->error() != QNetworkReply::NoError) {
+            complete(done, false, reply->errorString());
+            return;
+        }
+        // On success, remove locally
+        ++m_confirmedWrites;
+        if (applyDeleted(movie)) {
+            emit moviesChanged();
+        }
+        emit writesConfirmed();
+        complete(done, true);
+    });
+}
+
+bool MovieDatabase::enableOptimisticWrites(const QString& journalPath) {
+    QString error;
+    if (!m_journal.open(journalPath, &error)) {
+        setError(error);
         return false;
     }
-    const QByteArray data = reply->readAll();
-    reply->deleteLater();
-    QJsonDocument doc = QJsonDocument::fromJson(data);
-    if (doc.isObject()) {
-        Movie updated = Movie::fromJson(doc.object());
-        for (int i = 0; i < m_movies.size(); ++i) {
-            if (m_movies[i].getName() == original.getName() &&
-                m_movies[i].getYear() == original.getYear() &&
-                m_movies[i].getDateAdded() == original.getDateAdded()) {
-                m_movies[i] = updated;
-                break;
-            }
+    // Writes left over from the last session were never confirmed; show them and send them again
+    if (reapplyJournal()) {
+        emit moviesChanged();
+    }
+    replayJournal();
+    return true;
+}
+
+void MovieDatabase::writeOptimistically(WriteJournal::Entry entry, const Completion& done) {
+    // Durable first: once the journal has it, the write survives a crash or restart
+    QString error;
+    if (!m_journal.append(entry, &error)) {
+        complete(done, false, error);
+        return;
+    }
+    if (applyJournalEntry(entry)) {
+        emit moviesChanged();
+    }
+    complete(done, true);
+    replayJournal();
+}
+
+bool MovieDatabase::applyJournalEntry(const WriteJournal::Entry& entry) {
+    // Safe to repeat: entries are re-applied on top of every full reload until confirmed
+    switch (entry.op) {
+    case WriteJournal::Create:
+        if (findDuplicate(entry.movie.getName(), entry.movie.getYear()) >= 0) {
+            return false;
         }
+        insertRow(entry.movie);
         return true;
+    case WriteJournal::Update:
+        return applyUpdated(entry.original, entry.movie);
+    case WriteJournal::Delete:
+        return applyDeleted(entry.original);
     }
-    setError("Invalid response from API");
     return false;
 }
 
-bool MovieDatabase::deleteMovie(const Movie& movie) {
-    QNetworkRequest req(QUrl(m_apiBaseUrl + "/movies/delete"));
-    req.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
-    QJsonObject key;
-    key["name"] = movie.getName();
-    key["year"] = movie.getYear();
-    key["date_added"] = movie.getDateAdded().toString("yyyy-MM-dd");
-    clearError();
-    QNetworkReply* reply = m_network.post(req, QJsonDocument(key).toJson());
-    QEventLoop loop;
-    QObject::connect(reply, &QNetworkReply::finished, &loop, &QEventLoop::quit);
-    loop.exec();
-    if (reply->error() != QNetworkReply::NoError) {
-        setError(reply->errorString());
-        reply->deleteLater();
-        return false;
+bool MovieDatabase::reapplyJournal() {
+    bool changed = false;
+    for (const WriteJournal::Entry& entry : m_journal.pending()) {
+        changed |= applyJournalEntry(entry);
     }
-    // On success, remove locally
-    for (int i = 0; i < m_movies.size(); ++i) {
-        if (m_movies[i].getName() == movie.getName() &&
-            m_movies[i].getYear() == movie.getYear() &&
-            m_movies[i].getDateAdded() == movie.getDateAdded()) {
-            m_movies.removeAt(i);
+    return changed;
+}
+
+void MovieDatabase::replayJournal() {
+    // Oldest first, so the backend sees writes in the order they were made. The
+    // front of the journal goes out as one /movies/batch; backends without it get
+    // one request per entry.
+    if (m_replaying || m_replayTimer.isActive() || m_journal.isEmpty()) {
+        return;
+    }
+    m_replaying = true;
+    const QVector<WriteJournal::Entry> entries = m_journal.pending().mid(0, m_replayBatches ? kReplayBatchSize : 1);
+    QNetworkReply* reply = nullptr;
+    if (m_replayBatches) {
+        QJsonArray operations;
+        for (const WriteJournal::Entry& entry : entries) {
+            operations.append(batchOperation(entry.op, entry.original, entry.movie));
+        }
+        QJsonObject body;
+        body["operations"] = operations;
+        reply = m_network.post(jsonRequest("/movies/batch"), QJsonDocument(body).toJson());
+    } else {
+        const WriteJournal::Entry& entry = entries.first();
+        switch (entry.op) {
+        case WriteJournal::Create:
+            reply = m_network.post(jsonRequest("/movies"), QJsonDocument(createBody(entry.movie)).toJson());
+            break;
+        case WriteJournal::Update: {
+            QJsonObject payload;
+            payload["original"] = identityKey(entry.original);
+            payload["updated"] = entry.movie.toJson();
+            reply = m_network.put(jsonRequest("/movies"), QJsonDocument(payload).toJson());
+            break;
+        }
+        case WriteJournal::Delete:
+            reply = m_network.post(jsonRequest("/movies/delete"), QJsonDocument(identityKey(entry.original)).toJson());
             break;
         }
     }
-    reply->deleteLater();
+    const bool batched = m_replayBatches;
+    onReply(reply, [this, entries, batched](QNetworkReply* reply) {
+        const int status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+        if (status == 0 || status == 408 || status == 429 || status >= 500) {
+            retryReplay();
+            return;
+        }
+        QVector<ReplayResult> results;
+        if (!batched) {
+            const bool ok = reply->error() == QNetworkReply::NoError;
+            const QJsonDocument doc = ok ? QJsonDocument::fromJson(reply->readAll()) : QJsonDocument();
+            results.append({status, doc.object(), ok ? QString() : reply->errorString()});
+        } else if (reply->error() == QNetworkReply::NoError) {
+            const QJsonArray array = QJsonDocument::fromJson(reply->readAll()).object().value("results").toArray();
+            for (const QJsonValue& value : array) {
+                const QJsonObject result = value.toObject();
+                results.append({result.value("status").toInt(), result.value("movie").toObject(),
+                                result.value("detail").toString()});
+            }
+        }
+        if (batched && results.size() != entries.size()) {
+            // No /movies/batch, or the batch was refused as a whole: one request per
+            // entry pins any refusal on the entry that caused it
+            m_replayBatches = false;
+            m_replaying = false;
+            replayJournal();
+            return;
+        }
+        m_replayBackoffMs = 1000;
+        confirmReplay(entries, results, 0);
+    });
+}
+
+void MovieDatabase::retryReplay() {
+    // Unreachable or temporarily failing: keep the entries and retry with backoff
+    m_replaying = false;
+    m_replayTimer.start(m_replayBackoffMs);
+    m_replayBackoffMs = qMin(m_replayBackoffMs * 2, 60000);
+}
+
+void MovieDatabase::confirmReplay(const QVector<WriteJournal::Entry>& entries, QVector<ReplayResult> results, int from) {
+    // An entry the server applied just before a crash, with the acknowledgement lost,
+    // comes back as a duplicate (create) or a missing row (update, delete). It is
+    // not a rejection when the server already holds what the entry would have written.
+    for (int i = from; i < entries.size(); ++i) {
+        const WriteJournal::Entry& entry = entries[i];
+        if (entry.op == WriteJournal::Delete && results[i].status == 404) {
+            results[i].status = 200; // already gone
+            continue;
+        }
+        if (!((entry.op == WriteJournal::Create && results[i].status == 409)
+              || (entry.op == WriteJournal::Update && results[i].status == 404))) {
+            continue;
+        }
+        MovieQuery query;
+        query.nameContains = entry.movie.getName().trimmed();
+        query.addedFrom = entry.movie.getDateAdded();
+        query.addedTo = entry.movie.getDateAdded();
+        fetchPageAsync(query, SortByDateAdded, false, QString(), 1000,
+                       [this, entries, results, i](bool ok, const QString&, const MovieStore& page, const QString&) mutable {
+            if (!ok) {
+                retryReplay(); // resending is safe: this check runs again on the answer
+                return;
+            }
+            for (int row = 0; row < page.size(); ++row) {
+                const Movie movie = page.movie(row);
+                if (storedAs(movie, entries[i].movie)) {
+                    results[i] = {200, movie.toJson(), QString()};
+                    break;
+                }
+            }
+            confirmReplay(entries, results, i + 1);
+        });
+        return;
+    }
+    finishReplay(entries, results);
+}
+
+void MovieDatabase::finishReplay(const QVector<WriteJournal::Entry>& entries, const QVector<ReplayResult>& results) {
+    // The backend has decided on every entry sent, accepted or not
+    m_replaying = false;
+    QString error;
+    if (!m_journal.acknowledge(entries.last().seq, &error)) {
+        qWarning() << error;
+    }
+    const quint64 confirmed = m_confirmedWrites;
+    bool rejected = false;
+    bool changed = false;
+    for (int i = 0; i < entries.size(); ++i) {
+        const WriteJournal::Entry& entry = entries[i];
+        if (results[i].status != 200) {
+            // Refused for good (duplicate, row gone, invalid): the server's state wins
+            emit writeRejected(entry.op == WriteJournal::Delete ? entry.original : entry.movie, results[i].error);
+            rejected = true;
+            continue;
+        }
+        ++m_confirmedWrites; // no longer re-applied after a reload, so a reload must include it
+        if (entry.op != WriteJournal::Delete && !results[i].movie.isEmpty()) {
+            // Adopt the server's copy (it has the backend id)
+            changed |= applyUpdated(entry.movie, Movie::fromJson(results[i].movie));
+        }
+    }
+    if (rejected) {
+        // The reload re-applies the entries still waiting in the journal
+        loadFromApiAsync();
+    } else {
+        // Put later local edits back on top of the server's copies
+        changed |= reapplyJournal();
+    }
+    if (changed) {
+        emit moviesChanged();
+    }
+    if (m_confirmedWrites != confirmed) {
+        emit writesConfirmed();
+    }
+    replayJournal();
+}
+
+void MovieDatabase::setWriteCoalescing(int windowMs, int maxBatch) {
+    m_coalesceWindowMs = qMax(0, windowMs);
+    m_coalesceMaxBatch = qBound(1, maxBatch, kMaxBatchOperations);
+    if (m_coalesceWindowMs == 0) {
+        flushWrites(); // nothing may stay queued once coalescing is off
+    }
+}
+
+void MovieDatabase::enqueueWrite(const PendingWrite& write) {
+    m_writeQueue.append(write);
+    if (m_writeQueue.size() >= m_coalesceMaxBatch) {
+        flushWrites();
+    } else if (!m_flushTimer.isActive()) {
+        // The window starts at the first queued write, so no write waits longer than it
+        m_flushTimer.start(m_coalesceWindowMs);
+    }
+}
+
+void MovieDatabase::flushWrites() {
+    m_flushTimer.stop();
+    if (m_writeQueue.isEmpty()) {
+        return;
+    }
+    const QVector<PendingWrite> batch = m_writeQueue;
+    m_writeQueue.clear();
+
+    static const WriteJournal::Op ops[] = {WriteJournal::Create, WriteJournal::Update, WriteJournal::Delete};
+    QJsonArray operations;
+    for (const PendingWrite& write : batch) {
+        operations.append(batchOperation(ops[write.kind], write.original, write.movie));
+    }
+    QJsonObject body;
+    body["operations"] = operations;
+
+    QNetworkReply* reply = m_network.post(jsonRequest("/movies/batch"), QJsonDocument(body).toJson());
+    onReply(reply, [this, batch](QNetworkReply* reply) {
+        if (reply->error() == QNetworkReply::ContentNotFoundError) {
+            // Backend without /movies/batch: send the writes one by one, in order.
+            // Their completions are already timed from when they were queued.
+            for (const PendingWrite& write : batch) {
+                switch (write.kind) {
+                case PendingWrite::Create: sendCreate(write.movie, write.done); break;
+                case PendingWrite::Update: sendUpdate(write.original, write.movie, write.done); break;
+                case PendingWrite::Delete: sendDelete(write.original, write.done); break;
+                }
+            }
+            return;
+        }
+        QJsonArray results;
+        QString error;
+        if (reply->error() != QNetworkReply::NoError) {
+            error = reply->errorString();
+        } else {
+            results = QJsonDocument::fromJson(reply->readAll()).object().value("results").toArray();
+            if (results.size() != batch.size()) {
+                error = "Invalid response from API";
+            }
+        }
+        if (!error.isEmpty()) {
+            for (const PendingWrite& write : batch) {
+                complete(write.done, false, error);
+            }
+            return;
+        }
+        // Apply every confirmed write first, then redraw once for the whole batch
+        const quint64 confirmed = m_confirmedWrites;
+        bool changed = false;
+        for (int i = 0; i < batch.size(); ++i) {
+            const QJsonObject result = results[i].toObject();
+            if (result.value("status").toInt() != 200) {
+                continue;
+            }
+            const PendingWrite& write = batch[i];
+            ++m_confirmedWrites;
+            switch (write.kind) {
+            case PendingWrite::Create:
+                insertRow(Movie::fromJson(result.value("movie").toObject()));
+                changed = true;
+                break;
+            case PendingWrite::Update:
+                changed |= applyUpdated(write.original, Movie::fromJson(result.value("movie").toObject()));
+                break;
+            case PendingWrite::Delete:
+                changed |= applyDeleted(write.original);
+                break;
+            }
+        }
+        if (changed) {
+            emit moviesChanged();
+        }
+        if (m_confirmedWrites != confirmed) {
+            emit writesConfirmed();
+        }
+        for (int i = 0; i < batch.size(); ++i) {
+            const QJsonObject result = results[i].toObject();
+            const bool ok = result.value("status").toInt() == 200;
+            complete(batch[i].done, ok, ok ? QString() : result.value("detail").toString());
+        }
+    });
+}
+
+void MovieDatabase::waitUntilReadyAsync(int timeoutMs, Completion done) {
+    // One row is enough to know the API answers; the collection comes from the sync that follows
+    QNetworkRequest req = jsonRequest("/movies?limit=1");
+    req.setTransferTimeout(timeoutMs);
+    QNetworkReply* reply = m_network.get(req);
+    onReply(reply, [this, done](QNetworkReply* reply) {
+        const bool ok = (reply->error() == QNetworkReply::NoError);
+        complete(done, ok, ok ? QString() : reply->errorString());
+    });
+}
+
+QString MovieDatabase::defaultSnapshotPath(const QString& apiBaseUrl) {
+    return localDataPath(apiBaseUrl, "snapshot");
+}
+
+QString MovieDatabase::defaultJournalPath(const QString& apiBaseUrl) {
+    return localDataPath(apiBaseUrl, "journal");
+}
+
+bool MovieDatabase::loadSnapshot() {
+    if (m_snapshotPath.isEmpty()) {
+        return false;
+    }
+    TraceSpan span("MovieDatabase::loadSnapshot");
+    MovieStore store;
+    qint64 revision = -1;
+    if (!SnapshotFile::read(m_snapshotPath, store, revision)) {
+        return false; // missing or unusable; the caller loads from the API instead
+    }
+    span.setArg("movies", store.size());
+    resetStore(store);
+    m_revision = revision;
+    reapplyJournal();
+    emit moviesChanged();
     return true;
 }
 
+void MovieDatabase::saveSnapshotAsync() const {
+    if (m_snapshotPath.isEmpty()) {
+        return;
+    }
+    // The store copy is copy-on-write, so the worker serializes a frozen state while the UI keeps editing
+    const MovieStore store = m_store;
+    const qint64 revision = m_revision;
+    const QString path = m_snapshotPath;
+    QThreadPool::globalInstance()->start([store, revision, path]() {
+        TRACE_SCOPE("SnapshotFile::write");
+        QDir().mkpath(QFileInfo(path).absolutePath());
+        QString error;
+        if (!SnapshotFile::write(path, store, revision, &error)) {
+            qWarning() << "Failed to write snapshot" << path << ":" << error;
+        }
+    });
+}
+
+bool MovieDatabase::loadFromApi() {
+    return runBlocking([this](Completion done) { loadFromApiAsync(done); });
+}
+
+bool MovieDatabase::syncFromApi() {
+    return runBlocking([this](Completion done) { syncFromApiAsync(done); });
+}
+
+bool MovieDatabase::addMovie(const Movie& movie) {
+    return runBlocking([this, &movie](Completion done) { addMovieAsync(movie, done); });
+}
+
+bool MovieDatabase::updateMovie(const Movie& original, const Movie& movie) {
+    return runBlocking([this, &original, &movie](Completion done) { updateMovieAsync(original, movie, done); });
+}
+
+bool MovieDatabase::deleteMovie(const Movie& movie) {
+    return runBlocking([this, &movie](Completion done) { deleteMovieAsync(movie, done); });
+}
+
 bool MovieDatabase::waitUntilReady(int timeoutMs) {
-    clearError();
-    QNetworkRequest req(QUrl(m_apiBaseUrl + "/movies"));
-    req.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
-    QNetworkReply* reply = m_network.get(req);
-    QEventLoop loop;
-    QTimer timer;
-    timer.setSingleShot(true);
-    QObject::connect(&timer, &QTimer::timeout, &loop, &QEventLoop::quit);
-    QObject::connect(reply, &QNetworkReply::finished, &loop, &QEventLoop::quit);
-    timer.start(timeoutMs);
-    loop.exec();
-    bool ok = (reply->error() == QNetworkReply::NoError);
-    if (!ok && reply->error() != QNetworkReply::NoError) {
-        setError(reply->errorString());
+    return runBlocking([this, timeoutMs](Completion done) { waitUntilReadyAsync(timeoutMs, done); });
+}
+
+void MovieDatabase::resetRows(const QVector<Movie>& movies) {
+    MovieStore store;
+    store.reserve(movies.size());
+    for (const Movie& movie : movies) {
+        store.append(movie);
     }
-    reply->deleteLater();
-    return ok;
+    resetStore(store);
 }
 
-QVector<Movie> MovieDatabase::searchByName(const QString& name) const {
-    QVector<Movie> results;
-    for (const Movie& movie : m_movies) {
-        if (movie.getName().contains(name, Qt::CaseInsensitive)) {
-            results.append(movie);
+void MovieDatabase::resetStore(const MovieStore& store) {
+    TraceSpan span("MovieDatabase::resetStore");
+    span.setArg("movies", store.size());
+    ++m_storeVersion;
+    m_store = store;
+    const int rows = m_store.size();
+    m_rowById.clear();
+    m_rowById.reserve(rows);
+    m_rowsByIdentity.clear();
+    m_rowsByIdentity.reserve(rows);
+    m_rowsByDuplicateKey.clear();
+    m_rowsByDuplicateKey.reserve(rows);
+    m_nameIndex.clear();
+    m_directorIndex.clear();
+    m_fuzzyNameIndex.clear();
+    m_fuzzyDirectorIndex.clear();
+    m_textIndex.clear();
+    m_nameKeys.clear();
+    m_nameKeys.reserve(rows);
+    for (int row = 0; row < rows; ++row) {
+        m_nameKeys.append(m_collator.sortKey(m_store.name(row).toString()));
+        indexLookups(row);
+    }
+    // Build each sort index once; later changes keep them ordered incrementally
+    for (SortKey key : {SortByDateAdded, SortByName, SortByYear}) {
+        QVector<int>& index = sortIndex(key);
+        index.resize(rows);
+        std::iota(index.begin(), index.end(), 0);
+        std::sort(index.begin(), index.end(), [this, key](int a, int b) { return rowLess(key, a, b); });
+    }
+    m_collectionSize->set(rows);
+}
+
+void MovieDatabase::releaseSnapshots() {
+    // Holders that can let go do so now, so the change below edits the columns in place
+    // instead of copying all of them away from a shared snapshot
+    if (m_storeShared) {
+        m_storeShared = false;
+        emit moviesAboutToChange();
+    }
+}
+
+void MovieDatabase::insertRow(const Movie& movie) {
+    releaseSnapshots();
+    ++m_storeVersion;
+    const int row = m_store.size();
+    m_store.append(movie);
+    m_nameKeys.append(m_collator.sortKey(movie.getName()));
+    indexRow(row);
+    m_collectionSize->set(m_store.size());
+}
+
+void MovieDatabase::replaceRow(int row, const Movie& movie) {
+    releaseSnapshots();
+    ++m_storeVersion;
+    unindexRow(row);
+    if (m_store.name(row) != movie.getName()) {
+        m_nameKeys[row] = m_collator.sortKey(movie.getName());
+    }
+    m_store.set(row, movie);
+    indexRow(row);
+}
+
+void MovieDatabase::removeRow(int row) {
+    releaseSnapshots();
+    ++m_storeVersion;
+    // The store moves the last row into the hole so removal doesn't shift every index after it
+    unindexRow(row);
+    const int last = m_store.size() - 1;
+    if (row != last) {
+        // The moved row changes number, so it is re-indexed under the new one
+        unindexRow(last);
+        m_nameKeys[row] = m_nameKeys[last];
+    }
+    m_store.removeRow(row);
+    m_nameKeys.removeLast();
+    if (row != last) {
+        indexRow(row);
+    }
+    m_collectionSize->set(m_store.size());
+}
+
+void MovieDatabase::indexLookups(int row) {
+    const qint64 id = m_store.id(row);
+    if (id > 0) {
+        m_rowById.insert(id, row);
+    }
+    m_rowsByIdentity.insert(identityHash(m_store.name(row), m_store.year(row), m_store.day(row)), row);
+    m_rowsByDuplicateKey.insert(duplicateHash(m_store.name(row), m_store.year(row)), row);
+    m_nameIndex.addRow(row, m_store.name(row));
+    m_directorIndex.addRow(row, m_store.director(row));
+    m_fuzzyNameIndex.addRow(row, m_store.name(row));
+    m_fuzzyDirectorIndex.addRow(row, m_store.director(row));
+    m_textIndex.addRow(row, m_store.name(row), m_store.notes(row));
+}
+
+void MovieDatabase::indexRow(int row) {
+    indexLookups(row);
+    sortIndexInsert(row);
+}
+
+void MovieDatabase::unindexRow(int row) {
+    // Must run while the row still holds the values it was indexed with
+    auto byId = m_rowById.find(m_store.id(row));
+    if (byId != m_rowById.end() && byId.value() == row) {
+        m_rowById.erase(byId);
+    }
+    m_rowsByIdentity.remove(identityHash(m_store.name(row), m_store.year(row), m_store.day(row)), row);
+    m_rowsByDuplicateKey.remove(duplicateHash(m_store.name(row), m_store.year(row)), row);
+    m_nameIndex.removeRow(row, m_store.name(row));
+    m_directorIndex.removeRow(row, m_store.director(row));
+    m_fuzzyNameIndex.removeRow(row, m_store.name(row));
+    m_fuzzyDirectorIndex.removeRow(row, m_store.director(row));
+    m_textIndex.removeRow(row, m_store.name(row), m_store.notes(row));
+    sortIndexErase(row);
+}
+
+size_t MovieDatabase::identityHash(QStringView name, int year, qint32 day) {
+    return qHashMulti(0, name, year, day);
+}
+
+size_t MovieDatabase::duplicateHash(QStringView name, int year) {
+    // Same rule as the backend's create check: trimmed, case-insensitive name plus year.
+    // Folding per character keeps the hash allocation-free.
+    size_t hash = size_t(year);
+    for (QChar c : name.trimmed()) {
+        hash = hash * 31 + c.toCaseFolded().unicode();
+    }
+    return hash;
+}
+
+int MovieDatabase::findDuplicate(const QString& name, int year) const {
+    // Rows sharing a hash are confirmed against the stored values
+    const QStringView wanted = QStringView(name).trimmed();
+    auto range = m_rowsByDuplicateKey.equal_range(duplicateHash(name, year));
+    for (auto it = range.first; it != range.second; ++it) {
+        const int row = it.value();
+        if (m_store.year(row) == year && m_store.name(row).trimmed().compare(wanted, Qt::CaseInsensitive) == 0) {
+            return row;
         }
     }
-    return results;
+    return -1;
 }
 
-QVector<Movie> MovieDatabase::searchByDirector(const QString& director) const {
-    QVector<Movie> results;
-    for (const Movie& movie : m_movies) {
-        if (movie.getDirector().contains(director, Qt::CaseInsensitive)) {
-            results.append(movie);
+bool MovieDatabase::rowLess(SortKey key, int a, int b) const {
+    switch (key) {
+    case SortByName: {
+        const int cmp = m_nameKeys[a].compare(m_nameKeys[b]);
+        if (cmp != 0) {
+            return cmp < 0;
+        }
+        break;
+    }
+    case SortByYear:
+        if (m_store.year(a) != m_store.year(b)) {
+            return m_store.year(a) < m_store.year(b);
         }
+        break;
+    case SortByDateAdded:
+        if (m_store.day(a) != m_store.day(b)) {
+            return m_store.day(a) < m_store.day(b);
+        }
+        break;
+    }
+    return a < b;
+}
+
+const QVector<int>& MovieDatabase::sortIndex(SortKey key) const {
+    switch (key) {
+    case SortByName: return m_byName;
+    case SortByYear: return m_byYear;
+    case SortByDateAdded: break;
+    }
+    return m_byDateAdded;
+}
+
+QVector<int>& MovieDatabase::sortIndex(SortKey key) {
+    return const_cast<QVector<int>&>(static_cast<const MovieDatabase*>(this)->sortIndex(key));
+}
+
+void MovieDatabase::sortIndexInsert(int row) {
+    for (SortKey key : {SortByDateAdded, SortByName, SortByYear}) {
+        QVector<int>& index = sortIndex(key);
+        auto pos = std::lower_bound(index.begin(), index.end(), row,
+                                    [this, key](int a, int b) { return rowLess(key, a, b); });
+        index.insert(pos, row);
+    }
+}
+
+void MovieDatabase::sortIndexErase(int row) {
+    // The row's values are unchanged since it was inserted, so a binary search finds it
+    for (SortKey key : {SortByDateAdded, SortByName, SortByYear}) {
+        QVector<int>& index = sortIndex(key);
+        auto pos = std::lower_bound(index.begin(), index.end(), row,
+                                    [this, key](int a, int b) { return rowLess(key, a, b); });
+        if (pos != index.end() && *pos == row) {
+            index.erase(pos);
+        }
+    }
+}
+
+int MovieDatabase::findRow(const Movie& movie) const {
+    if (movie.getId() > 0) {
+        const int row = m_rowById.value(movie.getId(), -1);
+        if (row >= 0) {
+            return row;
+        }
+    }
+    const qint32 day = MovieStore::dayNumber(movie.getDateAdded());
+    auto range = m_rowsByIdentity.equal_range(identityHash(movie.getName(), movie.getYear(), day));
+    for (auto it = range.first; it != range.second; ++it) {
+        const int row = it.value();
+        if (m_store.year(row) == movie.getYear() && m_store.day(row) == day && m_store.name(row) == movie.getName()) {
+            return row;
+        }
+    }
+    return -1;
+}
+
+void MovieDatabase::upsertById(const Movie& movie) {
+    int row = m_rowById.value(movie.getId(), -1);
+    if (row < 0) {
+        // Rows written by this client before they had an id are matched by identity
+        row = findRow(movie);
+    }
+    if (row >= 0) {
+        replaceRow(row, movie);
+    } else {
+        insertRow(movie);
+    }
+}
+
+QVector<int> MovieDatabase::findBySubstring(const TrigramIndex& index, QStringView (MovieStore::*field)(int) const,
+                                            const QString& query) const {
+    QVector<int> rows;
+    if (TrigramIndex::canSearch(query)) {
+        // The index narrows to rows holding every trigram; confirm the actual substring
+        for (int row : index.candidates(query)) {
+            if ((m_store.*field)(row).contains(query, Qt::CaseInsensitive)) {
+                rows.append(row);
+            }
+        }
+        return rows;
+    }
+    // One- and two-letter queries have no trigrams to look up
+    for (int row = 0; row < m_store.size(); ++row) {
+        if ((m_store.*field)(row).contains(query, Qt::CaseInsensitive)) {
+            rows.append(row);
+        }
+    }
+    return rows;
+}
+
+QVector<int> MovieDatabase::findByName(const QString& name) const {
+    return findBySubstring(m_nameIndex, &MovieStore::name, name);
+}
+
+QVector<int> MovieDatabase::findByDirector(const QString& director) const {
+    return findBySubstring(m_directorIndex, &MovieStore::director, director);
+}
+
+QVector<Movie> MovieDatabase::getAllMovies() const {
+    return moviesAt(allRows());
+}
+
+QVector<Movie> MovieDatabase::moviesAt(const QVector<int>& rows) const {
+    QVector<Movie> results;
+    results.reserve(rows.size());
+    for (int row : rows) {
+        results.append(m_store.movie(row));
     }
     return results;
 }
 
+QVector<int> MovieDatabase::allRows() const {
+    QVector<int> rows(m_store.size());
+    std::iota(rows.begin(), rows.end(), 0);
+    return rows;
+}
+
+QVector<int> MovieDatabase::sortedRows(SortKey key, bool descending) const {
+    const QVector<int>& index = sortIndex(key);
+    if (!descending) {
+        return index;
+    }
+    return QVector<int>(index.rbegin(), index.rend());
+}
+
+QVector<int> MovieDatabase::sortRows(const QVector<int>& rows, SortKey key, bool descending) const {
+    MetricTimer timer(m_sortDuration);
+    const QVector<int>& index = sortIndex(key);
+    QVector<int> result;
+    result.reserve(rows.size());
+    // Small subsets sort by their keys; large ones are cheaper to pick out of the index
+    if (rows.size() < index.size() / 16) {
+        result = rows;
+        std::sort(result.begin(), result.end(), [this, key](int a, int b) { return rowLess(key, a, b); });
+        if (descending) {
+            std::reverse(result.begin(), result.end());
+        }
+        return result;
+    }
+    QBitArray wanted(m_store.size());
+    for (int row : rows) {
+        wanted.setBit(row);
+    }
+    if (descending) {
+        for (auto it = index.rbegin(); it != index.rend(); ++it) {
+            if (wanted.testBit(*it)) {
+                result.append(*it);
+            }
+        }
+    } else {
+        for (int row : index) {
+            if (wanted.testBit(row)) {
+                result.append(row);
+            }
+        }
+    }
+    return result;
+}
+
+QVector<Movie> MovieDatabase::searchByName(const QString& name) const {
+    return moviesAt(findByName(name));
+}
+
+QVector<Movie> MovieDatabase::searchByDirector(const QString& director) const {
+    return moviesAt(findByDirector(director));
+}
+
 QVector<Movie> MovieDatabase::searchByDateRange(const QDate& startDate, const QDate& endDate) const {
-    QVector<Movie> results;
-    for (const Movie& movie : m_movies) {
-        QDate movieDate = movie.getDateAdded();
-        if (movieDate >= startDate && movieDate <= endDate) {
-            results.append(movie);
+    return moviesAt(rowsAddedBetween(startDate, endDate));
+}
+
+QVector<Movie> MovieDatabase::getFavorites() const {
+    MovieQuery favorites;
+    favorites.favoritesOnly = true;
+    return moviesAt(query(favorites));
+}
+
+QVector<int> MovieDatabase::rowsAddedBetween(const QDate& from, const QDate& to) const {
+    // The date index is ordered, so the range is one contiguous slice of it
+    auto first = m_byDateAdded.begin();
+    auto last = m_byDateAdded.end();
+    if (from.isValid()) {
+        first = std::lower_bound(first, last, MovieStore::dayNumber(from), [this](int row, qint32 day) {
+            return m_store.day(row) < day;
+        });
+    }
+    if (to.isValid()) {
+        last = std::upper_bound(first, last, MovieStore::dayNumber(to), [this](qint32 day, int row) {
+            return day < m_store.day(row);
+        });
+    }
+    return QVector<int>(first, last);
+}
+
+QVector<int> MovieDatabase::queryCandidates(const MovieQuery& query, bool& seeded) const {
+    // The smallest candidate set the indexes can give cheaply; seeded is false when
+    // no index applies and every row has to be scanned
+    QVector<int> candidates;
+    seeded = false;
+    auto consider = [&](QVector<int>&& rows) {
+        if (!seeded || rows.size() < candidates.size()) {
+            candidates = std::move(rows);
+            seeded = true;
         }
+    };
+    if (TrigramIndex::canSearch(query.nameContains)) {
+        consider(m_nameIndex.candidates(query.nameContains));
+    }
+    if (TrigramIndex::canSearch(query.directorContains)) {
+        consider(m_directorIndex.candidates(query.directorContains));
     }
+    if (query.hasDateRange() && (!seeded || candidates.size() > 64)) {
+        consider(rowsAddedBetween(query.addedFrom, query.addedTo));
+    }
+    return candidates;
+}
+
+QVector<int> MovieDatabase::query(const MovieQuery& query) const {
+    // Start from the index candidates, then check the remaining predicates row by row in a single pass
+    TraceSpan span("MovieDatabase::query");
+    MetricTimer timer(m_queryDuration);
+    bool seeded = false;
+    const QVector<int> candidates = queryCandidates(query, seeded);
+    const QueryMatcher matcher(m_store, query, seeded ? candidates.size() : m_store.size());
+
+    QVector<int> results;
+    if (seeded) {
+        results.reserve(candidates.size());
+        for (int row : candidates) {
+            if (matcher.matches(row)) {
+                results.append(row);
+            }
+        }
+    } else if (query.favoritesOnly) {
+        results.reserve(m_store.favoriteCount());
+        const QBitArray& favorites = m_store.favorites();
+        for (int row = 0; row < m_store.size(); ++row) {
+            if (favorites.testBit(row) && matcher.matches(row)) {
+                results.append(row);
+            }
+        }
+    } else {
+        results.reserve(m_store.size());
+        for (int row = 0; row < m_store.size(); ++row) {
+            if (matcher.matches(row)) {
+                results.append(row);
+            }
+        }
+    }
+    span.setArg("rows", results.size());
     return results;
 }
 
-QVector<Movie> MovieDatabase::getFavorites() const {
-    QVector<Movie> results;
-    for (const Movie& movie : m_movies) {
-        if (movie.isFavorite()) {
-            results.append(movie);
+QVector<int> MovieDatabase::fuzzyQuery(const MovieQuery& query) const {
+    // The fuzzy indexes rank the text predicates; the rest are checked on the ranked rows
+    TraceSpan span("MovieDatabase::fuzzyQuery");
+    MetricTimer timer(m_fuzzyQueryDuration);
+    QVector<FuzzyIndex::Match> ranked;
+    bool seeded = false;
+    auto combine = [&](QVector<FuzzyIndex::Match>&& matches) {
+        if (!seeded) {
+            ranked = std::move(matches);
+            seeded = true;
+            return;
+        }
+        // Both fields were searched: keep rows that match both, summing the distances
+        QVector<FuzzyIndex::Match> both;
+        auto a = ranked.cbegin();
+        auto b = matches.cbegin();
+        while (a != ranked.cend() && b != matches.cend()) {
+            if (a->row < b->row) {
+                ++a;
+            } else if (b->row < a->row) {
+                ++b;
+            } else {
+                both.append({a->row, a->distance + b->distance});
+                ++a;
+                ++b;
+            }
+        }
+        ranked.swap(both);
+    };
+    if (!query.nameContains.isEmpty()) {
+        combine(m_fuzzyNameIndex.search(query.nameContains));
+    }
+    if (!query.directorContains.isEmpty()) {
+        combine(m_fuzzyDirectorIndex.search(query.directorContains));
+    }
+
+    MovieQuery rest = query;
+    rest.nameContains.clear();
+    rest.directorContains.clear();
+    if (!seeded) {
+        return this->query(rest);
+    }
+    // Matches arrive in row order, so a stable sort keeps ties in row order too
+    std::stable_sort(ranked.begin(), ranked.end(), [](const FuzzyIndex::Match& a, const FuzzyIndex::Match& b) {
+        return a.distance < b.distance;
+    });
+    const QueryMatcher matcher(m_store, rest, ranked.size());
+    QVector<int> results;
+    results.reserve(ranked.size());
+    for (const FuzzyIndex::Match& match : ranked) {
+        if (matcher.matches(match.row)) {
+            results.append(match.row);
         }
     }
+    span.setArg("rows", results.size());
     return results;
 }
 
+QVector<int> MovieDatabase::textQuery(const QString& text, const MovieQuery& filters, int limit) const {
+    // Filters are applied while collecting hits, so the limit counts only rows that pass
+    TraceSpan span("MovieDatabase::textQuery");
+    MetricTimer timer(m_textQueryDuration);
+    const QueryMatcher matcher(m_store, filters, m_store.size());
+    const QVector<TextIndex::Hit> hits = m_textIndex.search(text, limit, [&matcher](int row) {
+        return matcher.matches(row);
+    });
+    QVector<int> rows;
+    rows.reserve(hits.size());
+    for (const TextIndex::Hit& hit : hits) {
+        rows.append(hit.row);
+    }
+    span.setArg("rows", rows.size());
+    return rows;
+}
+
+void MovieDatabase::queryAsync(const MovieQuery& query, QueryCompletion done) {
+    bool seeded = false;
+    const QVector<int> candidates = queryCandidates(query, seeded);
+    scanAsync(query, candidates, seeded, std::move(done));
+}
+
+void MovieDatabase::refineAsync(const QVector<int>& rows, const MovieQuery& query, QueryCompletion done) {
+    // Only the previous matches can still match, so they are the whole candidate set
+    scanAsync(query, rows, true, std::move(done));
+}
 
+void MovieDatabase::scanAsync(const MovieQuery& query, const QVector<int>& candidates, bool seeded,
+                              QueryCompletion done) {
+    const quint64 generation = ++*m_scanGeneration; // supersedes every scan still running
+    const quint64 version = m_storeVersion;
+    const int total = seeded ? candidates.size() : m_store.size();
+    // The matcher holds its own copy of the store (shared, copy-on-write), so workers never see later edits
+    auto matcher = std::make_shared<const QueryMatcher>(m_store, query, total);
+    const quint64 traceId = Trace::isEnabled() ? Trace::nextAsyncId() : 0;
+    if (traceId != 0) {
+        Trace::asyncBegin("MovieDatabase::scanAsync", traceId, QString("%1 rows").arg(total));
+    }
 
+    QElapsedTimer timer;
+    timer.start();
+    // Runs once per scan, superseded or not, so every span is closed and every scan timed
+    auto deliver = [this, generation, version, query, done, traceId, timer](const QVector<int>& rows) {
+        const bool superseded = generation != m_scanGeneration->load();
+        if (traceId != 0) {
+            if (superseded) {
+                Trace::asyncEnd("MovieDatabase::scanAsync", traceId, "superseded", 1);
+            } else {
+                Trace::asyncEnd("MovieDatabase::scanAsync", traceId, "rows", rows.size());
+            }
+        }
+        m_scanDuration->record(timer.nsecsElapsed()); // from the call to the result arriving on this thread
+        if (superseded) {
+            return; // a newer query replaced this one
+        }
+        if (version != m_storeVersion) {
+            queryAsync(query, done); // row numbers moved while scanning; run again on the current rows
+            return;
+        }
+        done(rows);
+    };
 
+    const int threads = qMax(1, m_scanPool.maxThreadCount());
+    if (total < kParallelScanRows || threads == 1) {
+        TRACE_SCOPE("MovieDatabase::scan");
+        QVector<int> rows;
+        for (int i = 0; i < total; ++i) {
+            const int row = seeded ? candidates[i] : i;
+            if (matcher->matches(row)) {
+                rows.append(row);
+            }
+        }
+        // Completion is always asynchronous, whichever path ran
+        QMetaObject::invokeMethod(this, [deliver, rows]() { deliver(rows); }, Qt::QueuedConnection);
+        return;
+    }
+
+    // Contiguous chunks, a few per core so uneven chunks still balance; results are merged in chunk order
+    const int chunkCount = qMin(threads * 4, (total + kMinScanChunk - 1) / kMinScanChunk);
+    struct ScanState {
+        QVector<QVector<int>> parts;
+        std::atomic<int> remaining;
+    };
+    auto state = std::make_shared<ScanState>();
+    state->parts.resize(chunkCount);
+    state->remaining = chunkCount;
+    std::shared_ptr<std::atomic<quint64>> current = m_scanGeneration;
+
+    for (int chunk = 0; chunk < chunkCount; ++chunk) {
+        const int begin = int(qint64(total) * chunk / chunkCount);
+        const int end = int(qint64(total) * (chunk + 1) / chunkCount);
+        m_scanPool.start([this, state, current, generation, matcher, candidates, seeded, chunk, begin, end, deliver]() {
+            TRACE_SCOPE("MovieDatabase::scanChunk");
+            QVector<int>& out = state->parts[chunk];
+            for (int i = begin; i < end; ++i) {
+                if ((i & 4095) == 0 && current->load() != generation) {
+                    break; // superseded: stop early, the result will be dropped anyway
+                }
+                const int row = seeded ? candidates[i] : i;
+                if (matcher->matches(row)) {
+                    out.append(row);
+                }
+            }
+            if (--state->remaining != 0) {
+                return;
+            }
+            if (current->load() != generation) {
+                // Nothing to merge, but the span and the timing still end on the owning thread
+                QMetaObject::invokeMethod(this, [deliver]() { deliver(QVector<int>()); }, Qt::QueuedConnection);
+                return;
+            }
+            // Last chunk to finish merges and hands the result to the owning thread
+            int size = 0;
+            for (const QVector<int>& part : state->parts) {
+                size += part.size();
+            }
+            QVector<int> rows;
+            rows.reserve(size);
+            for (const QVector<int>& part : state->parts) {
+                rows += part;
+            }
+            QMetaObject::invokeMethod(this, [deliver, rows]() { deliver(rows); }, Qt::QueuedConnection);
+        });
+    }
+}
+
+void MovieDatabase::cancelScans() {
+    ++*m_scanGeneration;
+}
@@ -0,0 +1,365 @@
+// ============== MovieJsonStream.cpp ==============
+#include "moviejsonstream.h"
+#include "movie.h"
+#include <QLatin1String>
+#include <cctype>
+#include <utility>
+
+namespace {
+
+bool isSpace(char c) {
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+// Reads the values of one complete, brace-balanced object
+class Cursor {
+public:
+    Cursor(const char* begin, const char* end) : m_pos(begin), m_end(end) {}
+
+    void skipSpace() {
+        while (m_pos < m_end && isSpace(*m_pos)) {
+            ++m_pos;
+        }
+    }
+
+    bool consume(char c) {
+        skipSpace();
+        if (m_pos < m_end && *m_pos == c) {
+            ++m_pos;
+            return true;
+        }
+        return false;
+    }
+
+    bool peek(char c) {
+        skipSpace();
+        return m_pos < m_end && *m_pos == c;
+    }
+
+    bool readString(QString& out) {
+        out.clear();
+        if (!consume('"')) {
+            return false;
+        }
+        const char* run = m_pos;
+        while (m_pos < m_end) {
+            const char c = *m_pos;
+            if (c == '"') {
+                out.append(QString::fromUtf8(run, m_pos - run));
+                ++m_pos;
+                return true;
+            }
+            if (c != '\\') {
+                ++m_pos;
+                continue;
+            }
+            // Escapes split the string into runs; runs end on ASCII, so UTF-8 sequences stay whole
+            out.append(QString::fromUtf8(run, m_pos - run));
+            if (m_end - m_pos < 2) {
+                return false;
+            }
+            const char escape = m_pos[1];
+            m_pos += 2;
+            switch (escape) {
+            case '"': out.append(QLatin1Char('"')); break;
+            case '\\': out.append(QLatin1Char('\\')); break;
+            case '/': out.append(QLatin1Char('/')); break;
+            case 'b': out.append(QLatin1Char('\b')); break;
+            case 'f': out.append(QLatin1Char('\f')); break;
+            case 'n': out.append(QLatin1Char('\n')); break;
+            case 'r': out.append(QLatin1Char('\r')); break;
+            case 't': out.append(QLatin1Char('\t')); break;
+            case 'u': {
+                // Surrogate pairs arrive as two escapes and are appended as two UTF-16 units
+                if (m_end - m_pos < 4) {
+                    return false;
+                }
+                bool ok = false;
+                const ushort unit = QByteArray::fromRawData(m_pos, 4).toUShort(&ok, 16);
+                if (!ok) {
+                    return false;
+                }
+                out.append(QChar(unit));
+                m_pos += 4;
+                break;
+            }
+            default:
+                return false;
+            }
+            run = m_pos;
+        }
+        return false;
+    }
+
+    bool readNumber(double& out) {
+        skipSpace();
+        const char* start = m_pos;
+        while (m_pos < m_end && (isdigit(uchar(*m_pos)) || *m_pos == '-' || *m_pos == '+'
+                                 || *m_pos == '.' || *m_pos == 'e' || *m_pos == 'E')) {
+            ++m_pos;
+        }
+        bool ok = false;
+        out = QByteArray::fromRawData(start, m_pos - start).toDouble(&ok);
+        return ok;
+    }
+
+    bool readLiteral(const char* literal) {
+        skipSpace();
+        const qsizetype length = qstrlen(literal);
+        if (m_end - m_pos < length || qstrncmp(m_pos, literal, size_t(length)) != 0) {
+            return false;
+        }
+        m_pos += length;
+        return true;
+    }
+
+    bool skipValue() {
+        skipSpace();
+        if (m_pos >= m_end) {
+            return false;
+        }
+        if (*m_pos == '"') {
+            QString ignored;
+            return readString(ignored);
+        }
+        if (*m_pos == '{' || *m_pos == '[') {
+            int depth = 0;
+            bool inString = false;
+            bool escaped = false;
+            for (; m_pos < m_end; ++m_pos) {
+                const char c = *m_pos;
+                if (inString) {
+                    if (escaped) escaped = false;
+                    else if (c == '\\') escaped = true;
+                    else if (c == '"') inString = false;
+                } else if (c == '"') {
+                    inString = true;
+                } else if (c == '{' || c == '[') {
+                    ++depth;
+                } else if ((c == '}' || c == ']') && --depth == 0) {
+                    ++m_pos;
+                    return true;
+                }
+            }
+            return false;
+        }
+        if (*m_pos == 't') return readLiteral("true");
+        if (*m_pos == 'f') return readLiteral("false");
+        if (*m_pos == 'n') return readLiteral("null");
+        double ignored = 0;
+        return readNumber(ignored);
+    }
+
+private:
+    const char* m_pos;
+    const char* m_end;
+};
+
+// Same leniency as Movie::fromJson: wrong types and nulls give the default value
+bool readText(Cursor& cursor, QString& out) {
+    if (cursor.peek('"')) {
+        return cursor.readString(out);
+    }
+    out.clear();
+    return cursor.skipValue();
+}
+
+bool readInteger(Cursor& cursor, qint64& out) {
+    out = 0;
+    if (cursor.peek('"') || cursor.peek('n') || cursor.peek('t') || cursor.peek('f')
+        || cursor.peek('{') || cursor.peek('[')) {
+        return cursor.skipValue();
+    }
+    double value = 0;
+    if (!cursor.readNumber(value)) {
+        return false;
+    }
+    if (value == qint64(value)) {
+        out = qint64(value);
+    }
+    return true;
+}
+
+QDate parseDate(const QString& text) {
+    // "yyyy-MM-dd" without going through QDate::fromString's format parser
+    if (text.size() != 10 || text[4] != QLatin1Char('-') || text[7] != QLatin1Char('-')) {
+        return QDate();
+    }
+    int parts[3] = {0, 0, 0};
+    const int starts[3] = {0, 5, 8};
+    const int lengths[3] = {4, 2, 2};
+    for (int part = 0; part < 3; ++part) {
+        for (int i = starts[part]; i < starts[part] + lengths[part]; ++i) {
+            if (!text[i].isDigit()) {
+                return QDate();
+            }
+            parts[part] = parts[part] * 10 + text[i].digitValue();
+        }
+    }
+    return QDate(parts[0], parts[1], parts[2]);
+}
+
+} // namespace
+
+MovieJsonStream::MovieJsonStream()
+    : m_state(BeforeArray), m_scanPos(0), m_objectStart(0), m_depth(0), m_inString(false), m_escaped(false) {}
+
+void MovieJsonStream::fail(const QString& error) {
+    m_state = Error;
+    m_error = error;
+    m_buffer.clear();
+}
+
+bool MovieJsonStream::feed(const QByteArray& chunk) {
+    if (m_state == Error) {
+        return false;
+    }
+    m_buffer.append(chunk);
+    const char* data = m_buffer.constData();
+    const qsizetype size = m_buffer.size();
+    qsizetype pos = m_scanPos;
+    qsizetype consumed = m_state == InObject ? m_objectStart : pos; // bytes that can be dropped
+    while (pos < size) {
+        const char c = data[pos++];
+        switch (m_state) {
+        case BeforeArray:
+            if (c == '[') {
+                m_state = InArray;
+            } else if (!isSpace(c)) {
+                fail("Invalid response from API: expected a JSON array");
+                return false;
+            }
+            consumed = pos;
+            break;
+        case InArray:
+            if (c == '{') {
+                m_state = InObject;
+                m_objectStart = pos - 1;
+                m_depth = 1;
+            } else if (c == ']') {
+                m_state = AfterArray;
+                consumed = pos;
+            } else if (c == ',' || isSpace(c)) {
+                consumed = pos;
+            } else {
+                fail("Invalid response from API: expected a movie object");
+                return false;
+            }
+            break;
+        case InObject:
+            if (m_inString) {
+                if (m_escaped) {
+                    m_escaped = false;
+                } else if (c == '\\') {
+                    m_escaped = true;
+                } else if (c == '"') {
+                    m_inString = false;
+                }
+            } else if (c == '"') {
+                m_inString = true;
+            } else if (c == '{' || c == '[') {
+                ++m_depth;
+            } else if ((c == '}' || c == ']') && --m_depth == 0) {
+                if (!decodeObject(data + m_objectStart, data + pos)) {
+                    fail("Invalid response from API: malformed movie object");
+                    return false;
+                }
+                m_state = InArray;
+                consumed = pos;
+            }
+            break;
+        case AfterArray:
+            if (!isSpace(c)) {
+                fail("Invalid response from API: data after the movie array");
+                return false;
+            }
+            consumed = pos;
+            break;
+        case Error:
+            return false;
+        }
+    }
+    // Keep only the unfinished object (if any) for the next chunk
+    m_buffer.remove(0, consumed);
+    m_scanPos = pos - consumed;
+    if (m_state == InObject) {
+        m_objectStart -= consumed;
+    }
+    return true;
+}
+
+bool MovieJsonStream::finish() {
+    if (m_state == Error) {
+        return false;
+    }
+    if (m_state != AfterArray) {
+        fail("Invalid response from API: truncated movie array");
+        return false;
+    }
+    return true;
+}
+
+MovieStore MovieJsonStream::takeStore() {
+    MovieStore store = std::move(m_store);
+    m_store = MovieStore();
+    return store;
+}
+
+bool MovieJsonStream::decodeObject(const char* begin, const char* end) {
+    Cursor cursor(begin, end);
+    if (!cursor.consume('{')) {
+        return false;
+    }
+    Movie movie;
+    movie.setDateAdded(QDate()); // absent or null date_added stays invalid, as in Movie::fromJson
+    QString key;
+    QString text;
+    qint64 number = 0;
+    if (cursor.consume('}')) {
+        m_store.append(movie);
+        return true;
+    }
+    do {
+        if (!cursor.readString(key) || !cursor.consume(':')) {
+            return false;
+        }
+        bool ok = true;
+        if (key == QLatin1String("name")) {
+            ok = readText(cursor, text);
+            movie.setName(text);
+        } else if (key == QLatin1String("director")) {
+            ok = readText(cursor, text);
+            movie.setDirector(text);
+        } else if (key == QLatin1String("notes")) {
+            ok = readText(cursor, text);
+            movie.setNotes(text);
+        } else if (key == QLatin1String("date_added")) {
+            ok = readText(cursor, text);
+            movie.setDateAdded(parseDate(text));
+        } else if (key == QLatin1String("year")) {
+            ok = readInteger(cursor, number);
+            movie.setYear(int(number));
+        } else if (key == QLatin1String("id")) {
+            ok = readInteger(cursor, number);
+            movie.setId(number);
+        } else if (key == QLatin1String("is_favorite")) {
+            if (cursor.peek('t')) {
+                ok = cursor.readLiteral("true");
+                movie.setFavorite(true);
+            } else {
+                ok = cursor.skipValue();
+                movie.setFavorite(false);
+            }
+        } else {
+            ok = cursor.skipValue();
+        }
+        if (!ok) {
+            return false;
+        }
+    } while (cursor.consume(','));
+    if (!cursor.consume('}')) {
+        return false;
+    }
+    m_store.append(movie);
+    return true;
+}
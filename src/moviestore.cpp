@@ -0,0 +1,155 @@
+// ============== MovieStore.cpp ==============
+#include "moviestore.h"
+
+void MovieStore::clear() {
+    *this = MovieStore();
+}
+
+void MovieStore::reserve(int rows) {
+    m_nameOffsets.reserve(rows);
+    m_nameLengths.reserve(rows);
+    m_notesOffsets.reserve(rows);
+    m_notesLengths.reserve(rows);
+    m_directorOf.reserve(rows);
+    m_years.reserve(rows);
+    m_days.reserve(rows);
+    m_ids.reserve(rows);
+}
+
+qint32 MovieStore::appendText(const QString& text) {
+    const qint32 offset = qint32(m_text.size());
+    m_text.append(text);
+    return offset;
+}
+
+int MovieStore::internDirector(const QString& director) {
+    auto it = m_directorIds.constFind(director);
+    if (it != m_directorIds.constEnd()) {
+        return it.value();
+    }
+    const int id = m_directorNames.size();
+    m_directorNames.append(director);
+    m_directorIds.insert(director, id);
+    return id;
+}
+
+void MovieStore::append(const Movie& movie) {
+    const int row = size();
+    m_nameOffsets.append(appendText(movie.getName()));
+    m_nameLengths.append(qint32(movie.getName().size()));
+    m_notesOffsets.append(appendText(movie.getNotes()));
+    m_notesLengths.append(qint32(movie.getNotes().size()));
+    m_directorOf.append(internDirector(movie.getDirector()));
+    m_years.append(qint16(movie.getYear()));
+    m_days.append(dayNumber(movie.getDateAdded()));
+    m_favorites.resize(row + 1);
+    m_favorites.setBit(row, movie.isFavorite());
+    m_favoriteCount += movie.isFavorite() ? 1 : 0;
+    m_ids.append(movie.getId());
+}
+
+void MovieStore::append(const MovieStore& other) {
+    const int first = size();
+    const qint32 textBase = qint32(m_text.size());
+    m_text.append(other.m_text);
+    m_deadText += other.m_deadText;
+    // The other store's director ids are local to it; map them into this dictionary once
+    QVector<int> directorIds(other.m_directorNames.size());
+    for (int id = 0; id < directorIds.size(); ++id) {
+        directorIds[id] = internDirector(other.m_directorNames[id]);
+    }
+    reserve(first + other.size());
+    for (int row = 0; row < other.size(); ++row) {
+        m_nameOffsets.append(textBase + other.m_nameOffsets[row]);
+        m_nameLengths.append(other.m_nameLengths[row]);
+        m_notesOffsets.append(textBase + other.m_notesOffsets[row]);
+        m_notesLengths.append(other.m_notesLengths[row]);
+        m_directorOf.append(directorIds[other.m_directorOf[row]]);
+    }
+    m_years.append(other.m_years);
+    m_days.append(other.m_days);
+    m_ids.append(other.m_ids);
+    m_favorites.resize(first + other.size());
+    for (int row = 0; row < other.size(); ++row) {
+        if (other.m_favorites.testBit(row)) {
+            m_favorites.setBit(first + row);
+        }
+    }
+    m_favoriteCount += other.m_favoriteCount;
+}
+
+void MovieStore::set(int row, const Movie& movie) {
+    // Unchanged text keeps its arena slot; changed text is appended and the old slot becomes dead
+    if (name(row) != movie.getName()) {
+        m_deadText += m_nameLengths[row];
+        m_nameOffsets[row] = appendText(movie.getName());
+        m_nameLengths[row] = qint32(movie.getName().size());
+    }
+    if (notes(row) != movie.getNotes()) {
+        m_deadText += m_notesLengths[row];
+        m_notesOffsets[row] = appendText(movie.getNotes());
+        m_notesLengths[row] = qint32(movie.getNotes().size());
+    }
+    m_directorOf[row] = internDirector(movie.getDirector());
+    m_years[row] = qint16(movie.getYear());
+    m_days[row] = dayNumber(movie.getDateAdded());
+    m_favoriteCount += (movie.isFavorite() ? 1 : 0) - (isFavorite(row) ? 1 : 0);
+    m_favorites.setBit(row, movie.isFavorite());
+    m_ids[row] = movie.getId();
+    compactText();
+}
+
+void MovieStore::removeRow(int row) {
+    const int last = size() - 1;
+    m_deadText += m_nameLengths[row] + m_notesLengths[row];
+    m_favoriteCount -= isFavorite(row) ? 1 : 0;
+    if (row != last) {
+        // Move the last row into the hole; its text stays where it is in the arena
+        m_nameOffsets[row] = m_nameOffsets[last];
+        m_nameLengths[row] = m_nameLengths[last];
+        m_notesOffsets[row] = m_notesOffsets[last];
+        m_notesLengths[row] = m_notesLengths[last];
+        m_directorOf[row] = m_directorOf[last];
+        m_years[row] = m_years[last];
+        m_days[row] = m_days[last];
+        m_favorites.setBit(row, m_favorites.testBit(last));
+        m_ids[row] = m_ids[last];
+    }
+    m_nameOffsets.removeLast();
+    m_nameLengths.removeLast();
+    m_notesOffsets.removeLast();
+    m_notesLengths.removeLast();
+    m_directorOf.removeLast();
+    m_years.removeLast();
+    m_days.removeLast();
+    m_favorites.resize(last);
+    m_ids.removeLast();
+    compactText();
+}
+
+Movie MovieStore::movie(int row) const {
+    Movie movie(name(row).toString(), year(row), m_directorNames[m_directorOf[row]],
+                notes(row).toString(), isFavorite(row));
+    movie.setDateAdded(dateAdded(row));
+    movie.setId(id(row));
+    return movie;
+}
+
+void MovieStore::compactText() {
+    // Rewrite the arena once more than half of it is dead
+    if (m_deadText < 4096 || m_deadText * 2 < m_text.size()) {
+        return;
+    }
+    QString text;
+    text.reserve(int(m_text.size() - m_deadText));
+    for (int row = 0; row < size(); ++row) {
+        const qint32 nameOffset = qint32(text.size());
+        text.append(name(row));
+        const qint32 notesOffset = qint32(text.size());
+        text.append(notes(row));
+        m_nameOffsets[row] = nameOffset;
+        m_notesOffsets[row] = notesOffset;
+    }
+    m_text = text;
+    m_deadText = 0;
+}
@@ -0,0 +1,199 @@
+// ============== MovieTableModel.cpp ==============
+#include "movietablemodel.h"
+#include <algorithm>
+#include <numeric>
+
+namespace {
+const int kPageSize = 200;
+}
+
+MovieTableModel::MovieTableModel(QObject* parent) : QAbstractTableModel(parent) {}
+
+void MovieTableModel::setView(const MovieView& view)
+{
+    beginResetModel();
+    ++m_generation;
+    m_database = nullptr;
+    m_pages.clear();
+    m_hasMore = false;
+    m_fetching = false;
+    m_view = view;
+    m_order.resize(m_view.size());
+    std::iota(m_order.begin(), m_order.end(), 0);
+    endResetModel();
+}
+
+void MovieTableModel::releaseView()
+{
+    if (isRemote() || m_view.snapshot().isEmpty()) {
+        return;
+    }
+    beginResetModel();
+    m_view = MovieView();
+    m_order.clear();
+    endResetModel();
+}
+
+int MovieTableModel::rowCount(const QModelIndex& parent) const
+{
+    return parent.isValid() ? 0 : m_order.size();
+}
+
+int MovieTableModel::columnCount(const QModelIndex& parent) const
+{
+    return parent.isValid() ? 0 : ColumnCount;
+}
+
+QVariant MovieTableModel::data(const QModelIndex& index, int role) const
+{
+    if (!index.isValid() || index.row() >= m_order.size()) {
+        return QVariant();
+    }
+    // Read the one column that is asked for straight from the store
+    const MovieStore& store = m_view.snapshot().store();
+    const int row = m_view.rowAt(m_order[index.row()]);
+
+    if (role == Qt::DisplayRole) {
+        switch (index.column()) {
+        case NameColumn: return store.name(row).toString();
+        case YearColumn: return store.year(row);
+        case DirectorColumn: return store.director(row).toString();
+        case DateAddedColumn: return store.dateAdded(row).toString("yyyy-MM-dd");
+        case NotesColumn: return store.notes(row).toString();
+        case FavoriteColumn: return store.isFavorite(row) ? QStringLiteral("★") : QString();
+        }
+    } else if (role == Qt::ToolTipRole && index.column() == NotesColumn) {
+        // Rows keep a fixed height, so long notes are readable from the tooltip
+        return store.notes(row).toString();
+    }
+    return QVariant();
+}
+
+QVariant MovieTableModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (orientation != Qt::Horizontal || role != Qt::DisplayRole) {
+        return QAbstractTableModel::headerData(section, orientation, role);
+    }
+    switch (section) {
+    case NameColumn: return QStringLiteral("Movie Name");
+    case YearColumn: return QStringLiteral("Year");
+    case DirectorColumn: return QStringLiteral("Director");
+    case DateAddedColumn: return QStringLiteral("Date Added");
+    case NotesColumn: return QStringLiteral("Notes");
+    case FavoriteColumn: return QStringLiteral("Favorite");
+    }
+    return QVariant();
+}
+
+void MovieTableModel::setRemoteQuery(MovieDatabase* database, const MovieQuery& query,
+                                     MovieDatabase::SortKey key, bool descending)
+{
+    beginResetModel();
+    ++m_generation;
+    m_database = database;
+    m_remoteQuery = query;
+    m_remoteKey = key;
+    m_remoteDescending = descending;
+    m_pages.clear();
+    m_view = MovieView();
+    m_order.clear();
+    m_nextCursor.clear();
+    m_hasMore = true;
+    m_fetching = false;
+    endResetModel();
+    fetchMore(QModelIndex());
+}
+
+bool MovieTableModel::canFetchMore(const QModelIndex& parent) const
+{
+    return !parent.isValid() && isRemote() && m_hasMore && !m_fetching;
+}
+
+void MovieTableModel::fetchMore(const QModelIndex& parent)
+{
+    if (!canFetchMore(parent)) {
+        return;
+    }
+    m_fetching = true;
+    const quint64 generation = m_generation;
+    m_database->fetchPageAsync(m_remoteQuery, m_remoteKey, m_remoteDescending, m_nextCursor, kPageSize,
+        [this, generation](bool ok, const QString& error, const MovieStore& page, const QString& nextCursor) {
+            if (generation != m_generation) {
+                return; // the model was reset while this page was in flight
+            }
+            m_fetching = false;
+            if (!ok) {
+                m_hasMore = false;
+                emit fetchFailed(error);
+                return;
+            }
+            appendPage(page, nextCursor);
+        });
+}
+
+void MovieTableModel::appendPage(const MovieStore& page, const QString& nextCursor)
+{
+    m_nextCursor = nextCursor;
+    m_hasMore = !nextCursor.isEmpty();
+    if (page.isEmpty()) {
+        return;
+    }
+    const int first = m_pages.size();
+    beginInsertRows(QModelIndex(), first, first + page.size() - 1);
+    // Release the view's share of the pages first, so appending doesn't copy everything loaded so far
+    QVector<int> rows = m_view.rows();
+    m_view = MovieView();
+    for (int row = 0; row < page.size(); ++row) {
+        m_pages.append(page.movie(row));
+        rows.append(first + row);
+        m_order.append(first + row);
+    }
+    m_view = MovieView(MovieSnapshot(m_pages), rows);
+    endInsertRows();
+}
+
+void MovieTableModel::sort(int column, Qt::SortOrder order)
+{
+    if (isRemote()) {
+        return; // only part of the result is loaded; the server decides the order
+    }
+    // Header clicks reorder the row mapping only; the movies themselves are not touched.
+    // Column -1 (indicator cleared) restores the order the movies were given in.
+    const MovieStore& store = m_view.snapshot().store();
+    auto less = [this, &store, column](int a, int b) {
+        if (column < 0) {
+            return a < b;
+        }
+        const int x = m_view.rowAt(a);
+        const int y = m_view.rowAt(b);
+        switch (column) {
+        case YearColumn: return store.year(x) < store.year(y);
+        case DirectorColumn: return QString::localeAwareCompare(store.director(x), store.director(y)) < 0;
+        case DateAddedColumn: return store.day(x) < store.day(y);
+        case NotesColumn: return QString::localeAwareCompare(store.notes(x), store.notes(y)) < 0;
+        case FavoriteColumn: return store.isFavorite(x) < store.isFavorite(y);
+        default: return QString::localeAwareCompare(store.name(x), store.name(y)) < 0;
+        }
+    };
+
+    emit layoutAboutToBeChanged({}, QAbstractItemModel::VerticalSortHint);
+    const QModelIndexList before = persistentIndexList();
+    const QVector<int> oldOrder = m_order;
+    if (order == Qt::AscendingOrder) {
+        std::stable_sort(m_order.begin(), m_order.end(), less);
+    } else {
+        std::stable_sort(m_order.begin(), m_order.end(), [&less](int a, int b) { return less(b, a); });
+    }
+    // Keep the selection on the same movies
+    QVector<int> newRowOf(m_view.size());
+    for (int row = 0; row < m_order.size(); ++row) {
+        newRowOf[m_order[row]] = row;
+    }
+    QModelIndexList after;
+    after.reserve(before.size());
+    for (const QModelIndex& index : before) {
+        after.append(index.isValid() ? createIndex(newRowOf[oldOrder[index.row()]], index.column()) : index);
+    }
+    changePersistentIndexList(before, after);
+    emit layoutChanged({}, QAbstractItemModel::VerticalSortHint);
+}
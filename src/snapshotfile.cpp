@@ -0,0 +1,235 @@
+// ============== SnapshotFile.cpp ==============
+#include "snapshotfile.h"
+#include <QFile>
+#include <QSaveFile>
+#include <cstring>
+
+namespace {
+
+const char kMagic[8] = {'R', 'M', 'M', 'S', 'N', 'A', 'P', '\0'};
+const quint32 kVersion = 1;
+const quint32 kByteOrderMark = 0x01020304;
+
+struct Header {
+    char magic[8];
+    quint32 version;
+    quint32 byteOrderMark;
+    qint64 revision;
+    qint32 rowCount;
+    qint32 directorCount;
+    qint64 textLength;      // UTF-16 code units in the arena
+    quint64 payloadSize;
+    quint64 checksum;       // FNV-1a over the payload
+};
+static_assert(sizeof(Header) == 56, "snapshot header layout changed");
+
+quint64 fnv1a(const uchar* data, quint64 size) {
+    quint64 hash = 14695981039346656037ull;
+    for (quint64 i = 0; i < size; ++i) {
+        hash ^= data[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+void appendAligned(QByteArray& out, const void* data, qint64 bytes) {
+    out.append(static_cast<const char*>(data), bytes);
+    const qint64 padding = (8 - out.size() % 8) % 8;
+    out.append(padding, '\0');
+}
+
+// Reads consecutive aligned arrays out of the mapped payload
+class Reader {
+public:
+    Reader(const uchar* data, quint64 size) : m_data(data), m_size(size) {}
+
+    template <typename T>
+    bool readArray(QVector<T>& out, qint64 count) {
+        const qint64 bytes = count * qint64(sizeof(T));
+        if (!fits(bytes)) {
+            return false;
+        }
+        out.resize(count);
+        std::memcpy(out.data(), m_data + m_pos, size_t(bytes));
+        skip(bytes);
+        return true;
+    }
+
+    bool readRaw(void* out, qint64 bytes) {
+        if (!fits(bytes)) {
+            return false;
+        }
+        std::memcpy(out, m_data + m_pos, size_t(bytes));
+        skip(bytes);
+        return true;
+    }
+
+private:
+    bool fits(qint64 bytes) const { return bytes >= 0 && quint64(m_pos + bytes) <= m_size; }
+    void skip(qint64 bytes) { m_pos += bytes + (8 - bytes % 8) % 8; }
+
+    const uchar* m_data;
+    quint64 m_size;
+    qint64 m_pos = 0;
+};
+
+} // namespace
+
+bool SnapshotFile::write(const QString& path, const MovieStore& store, qint64 revision, QString* error) {
+    QByteArray payload;
+    const qint64 rows = store.size();
+    appendAligned(payload, store.m_nameOffsets.constData(), rows * qint64(sizeof(qint32)));
+    appendAligned(payload, store.m_nameLengths.constData(), rows * qint64(sizeof(qint32)));
+    appendAligned(payload, store.m_notesOffsets.constData(), rows * qint64(sizeof(qint32)));
+    appendAligned(payload, store.m_notesLengths.constData(), rows * qint64(sizeof(qint32)));
+    appendAligned(payload, store.m_directorOf.constData(), rows * qint64(sizeof(qint32)));
+    appendAligned(payload, store.m_years.constData(), rows * qint64(sizeof(qint16)));
+    appendAligned(payload, store.m_days.constData(), rows * qint64(sizeof(qint32)));
+    appendAligned(payload, store.m_ids.constData(), rows * qint64(sizeof(qint64)));
+    QByteArray favorites((rows + 7) / 8, '\0');
+    for (qint64 row = 0; row < rows; ++row) {
+        if (store.m_favorites.testBit(int(row))) {
+            favorites[int(row / 8)] = char(favorites[int(row / 8)] | (1 << (row % 8)));
+        }
+    }
+    appendAligned(payload, favorites.constData(), favorites.size());
+    QVector<qint32> directorLengths;
+    directorLengths.reserve(store.m_directorNames.size());
+    for (const QString& director : store.m_directorNames) {
+        directorLengths.append(qint32(director.size()));
+    }
+    const QString directorText = store.m_directorNames.join(QString());
+    appendAligned(payload, directorLengths.constData(), directorLengths.size() * qint64(sizeof(qint32)));
+    appendAligned(payload, directorText.constData(), directorText.size() * qint64(sizeof(QChar)));
+    appendAligned(payload, store.m_text.constData(), store.m_text.size() * qint64(sizeof(QChar)));
+
+    Header header;
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.byteOrderMark = kByteOrderMark;
+    header.revision = revision;
+    header.rowCount = qint32(rows);
+    header.directorCount = qint32(store.m_directorNames.size());
+    header.textLength = store.m_text.size();
+    header.payloadSize = quint64(payload.size());
+    header.checksum = fnv1a(reinterpret_cast<const uchar*>(payload.constData()), header.payloadSize);
+
+    // Written to a temporary file and renamed, so a crash never leaves a torn snapshot
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        if (error) *error = file.errorString();
+        return false;
+    }
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(payload);
+    if (!file.commit()) {
+        if (error) *error = file.errorString();
+        return false;
+    }
+    return true;
+}
+
+bool SnapshotFile::read(const QString& path, MovieStore& store, qint64& revision, QString* error) {
+    auto fail = [error](const QString& message) {
+        if (error) *error = message;
+        return false;
+    };
+
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return fail(file.errorString());
+    }
+    if (file.size() < qint64(sizeof(Header))) {
+        return fail("Snapshot is truncated");
+    }
+    uchar* mapped = file.map(0, file.size());
+    if (!mapped) {
+        return fail("Cannot map snapshot: " + file.errorString());
+    }
+
+    Header header;
+    std::memcpy(&header, mapped, sizeof(header));
+    if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 || header.byteOrderMark != kByteOrderMark) {
+        return fail("Not a snapshot file for this platform");
+    }
+    if (header.version != kVersion) {
+        return fail(QString("Unsupported snapshot version %1").arg(header.version));
+    }
+    if (header.payloadSize != quint64(file.size()) - sizeof(Header) || header.rowCount < 0 || header.directorCount < 0) {
+        return fail("Snapshot is truncated");
+    }
+    const uchar* payload = mapped + sizeof(Header);
+    if (fnv1a(payload, header.payloadSize) != header.checksum) {
+        return fail("Snapshot checksum mismatch");
+    }
+
+    MovieStore loaded;
+    const qint64 rows = header.rowCount;
+    Reader reader(payload, header.payloadSize);
+    bool ok = reader.readArray(loaded.m_nameOffsets, rows)
+        && reader.readArray(loaded.m_nameLengths, rows)
+        && reader.readArray(loaded.m_notesOffsets, rows)
+        && reader.readArray(loaded.m_notesLengths, rows)
+        && reader.readArray(loaded.m_directorOf, rows)
+        && reader.readArray(loaded.m_years, rows)
+        && reader.readArray(loaded.m_days, rows)
+        && reader.readArray(loaded.m_ids, rows);
+    QVector<uchar> favorites;
+    QVector<qint32> directorLengths;
+    ok = ok && reader.readArray(favorites, (rows + 7) / 8)
+        && reader.readArray(directorLengths, header.directorCount);
+    qint64 directorChars = 0;
+    for (qint32 length : directorLengths) {
+        ok = ok && length >= 0;
+        directorChars += length;
+    }
+    QString directorText;
+    if (ok) {
+        directorText.resize(directorChars);
+        ok = reader.readRaw(directorText.data(), directorChars * qint64(sizeof(QChar)));
+    }
+    if (ok && header.textLength >= 0) {
+        loaded.m_text.resize(header.textLength);
+        ok = reader.readRaw(loaded.m_text.data(), header.textLength * qint64(sizeof(QChar)));
+    } else {
+        ok = false;
+    }
+    if (!ok) {
+        return fail("Snapshot is truncated");
+    }
+
+    // The checksum catches damage, not a writer bug; still never hand out views past the arena
+    qint64 liveText = 0;
+    for (qint64 row = 0; row < rows; ++row) {
+        const bool inRange = loaded.m_nameOffsets[row] >= 0 && loaded.m_nameLengths[row] >= 0
+            && loaded.m_nameOffsets[row] + qint64(loaded.m_nameLengths[row]) <= header.textLength
+            && loaded.m_notesOffsets[row] >= 0 && loaded.m_notesLengths[row] >= 0
+            && loaded.m_notesOffsets[row] + qint64(loaded.m_notesLengths[row]) <= header.textLength
+            && loaded.m_directorOf[row] >= 0 && loaded.m_directorOf[row] < header.directorCount;
+        if (!inRange) {
+            return fail("Snapshot is inconsistent");
+        }
+        liveText += loaded.m_nameLengths[row] + loaded.m_notesLengths[row];
+    }
+    loaded.m_deadText = header.textLength - liveText;
+
+    qint64 offset = 0;
+    for (int id = 0; id < directorLengths.size(); ++id) {
+        const QString director = directorText.mid(offset, directorLengths[id]);
+        offset += directorLengths[id];
+        loaded.m_directorNames.append(director);
+        loaded.m_directorIds.insert(director, id);
+    }
+
+    loaded.m_favorites.resize(int(rows));
+    for (qint64 row = 0; row < rows; ++row) {
+        if (favorites[int(row / 8)] & (1 << (row % 8))) {
+            loaded.m_favorites.setBit(int(row));
+            ++loaded.m_favoriteCount;
+        }
+    }
+
+    store = loaded;
+    revision = header.revision;
+    return true;
+}
@@ -0,0 +1,240 @@
+// ============== TextIndex.cpp ==============
+#include "textindex.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// BM25 parameters: term frequency saturation and document length normalization
+const float kK1 = 1.2f;
+const float kB = 0.75f;
+// Rows per posting block: appends start a new block at this size, inserts split one at twice it
+const int kBlockRows = 128;
+
+template <typename Fn>
+void forEachWord(QStringView text, Fn fn) {
+    qsizetype start = -1;
+    for (qsizetype i = 0; i <= text.size(); ++i) {
+        const bool inWord = i < text.size() && text[i].isLetterOrNumber();
+        if (inWord && start < 0) {
+            start = i;
+        } else if (!inWord && start >= 0) {
+            fn(text.mid(start, i - start).toString().toCaseFolded());
+            start = -1;
+        }
+    }
+}
+
+} // namespace
+
+void TextIndex::clear() {
+    m_postings.clear();
+    m_lengths.clear();
+    m_totalLength = 0;
+    m_documents = 0;
+}
+
+QHash<QString, int> TextIndex::termFrequencies(QStringView name, QStringView notes, int& length) {
+    QHash<QString, int> tfs;
+    length = 0;
+    forEachWord(name, [&](const QString& word) {
+        tfs[word] += NameWeight;
+        length += NameWeight;
+    });
+    forEachWord(notes, [&](const QString& word) {
+        ++tfs[word];
+        ++length;
+    });
+    return tfs;
+}
+
+void TextIndex::appendVarint(QByteArray& out, quint32 value) {
+    while (value >= 0x80) {
+        out.append(char((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    out.append(char(value));
+}
+
+quint32 TextIndex::readVarint(const char*& p) {
+    quint32 value = 0;
+    int shift = 0;
+    quint8 byte;
+    do {
+        byte = quint8(*p++);
+        value |= quint32(byte & 0x7F) << shift;
+        shift += 7;
+    } while (byte & 0x80);
+    return value;
+}
+
+void TextIndex::decode(const Block& block, QVector<int>& rows, QVector<int>& tfs) {
+    rows.clear();
+    tfs.clear();
+    rows.reserve(block.rows);
+    tfs.reserve(block.rows);
+    const char* p = block.data.constData();
+    int row = -1;
+    for (int i = 0; i < block.rows; ++i) {
+        row += int(readVarint(p));
+        rows.append(row);
+        tfs.append(int(readVarint(p)));
+    }
+}
+
+void TextIndex::encode(Block& block, const QVector<int>& rows, const QVector<int>& tfs, int from, int to) {
+    block.data.clear();
+    int previous = -1;
+    for (int i = from; i < to; ++i) {
+        appendVarint(block.data, quint32(rows[i] - previous));
+        appendVarint(block.data, quint32(tfs[i]));
+        previous = rows[i];
+    }
+    block.rows = to - from;
+    block.lastRow = previous;
+}
+
+QVector<TextIndex::Block>::iterator TextIndex::findBlock(Posting& posting, int row) {
+    return std::lower_bound(posting.blocks.begin(), posting.blocks.end(), row,
+                            [](const Block& block, int r) { return block.lastRow < r; });
+}
+
+void TextIndex::addRow(int row, QStringView name, QStringView notes) {
+    int length = 0;
+    const QHash<QString, int> tfs = termFrequencies(name, notes, length);
+    if (m_lengths.size() <= row) {
+        m_lengths.resize(row + 1);
+    }
+    m_lengths[row] = quint32(length);
+    m_totalLength += length;
+    ++m_documents;
+
+    QVector<int> rows;
+    QVector<int> counts;
+    for (auto it = tfs.cbegin(); it != tfs.cend(); ++it) {
+        Posting& posting = m_postings[it.key()];
+        ++posting.rows;
+        if (posting.blocks.isEmpty() || row > posting.blocks.last().lastRow) {
+            // Rows are usually appended, so the common case extends the last block
+            if (posting.blocks.isEmpty() || posting.blocks.last().rows >= kBlockRows) {
+                posting.blocks.append(Block());
+            }
+            Block& block = posting.blocks.last();
+            appendVarint(block.data, quint32(row - block.lastRow));
+            appendVarint(block.data, quint32(it.value()));
+            ++block.rows;
+            block.lastRow = row;
+            continue;
+        }
+        auto block = findBlock(posting, row);
+        decode(*block, rows, counts);
+        const int pos = int(std::lower_bound(rows.begin(), rows.end(), row) - rows.begin());
+        rows.insert(pos, row);
+        counts.insert(pos, it.value());
+        if (rows.size() <= 2 * kBlockRows) {
+            encode(*block, rows, counts, 0, rows.size());
+            continue;
+        }
+        const int half = rows.size() / 2;
+        Block upper;
+        encode(upper, rows, counts, half, rows.size());
+        encode(*block, rows, counts, 0, half);
+        posting.blocks.insert(block + 1, upper);
+    }
+}
+
+void TextIndex::removeRow(int row, QStringView name, QStringView notes) {
+    int length = 0;
+    const QHash<QString, int> tfs = termFrequencies(name, notes, length);
+    --m_documents;
+    if (row < m_lengths.size()) {
+        m_totalLength -= m_lengths[row];
+        m_lengths[row] = 0;
+    }
+    // Rows without words have no postings, so trailing zero lengths are never read
+    while (!m_lengths.isEmpty() && m_lengths.last() == 0) {
+        m_lengths.removeLast();
+    }
+
+    QVector<int> rows;
+    QVector<int> counts;
+    for (auto it = tfs.cbegin(); it != tfs.cend(); ++it) {
+        auto found = m_postings.find(it.key());
+        if (found == m_postings.end()) {
+            continue;
+        }
+        Posting& posting = found.value();
+        auto block = findBlock(posting, row);
+        if (block == posting.blocks.end()) {
+            continue;
+        }
+        decode(*block, rows, counts);
+        auto pos = std::lower_bound(rows.begin(), rows.end(), row);
+        if (pos == rows.end() || *pos != row) {
+            continue;
+        }
+        const int index = int(pos - rows.begin());
+        rows.remove(index);
+        counts.remove(index);
+        --posting.rows;
+        if (!rows.isEmpty()) {
+            encode(*block, rows, counts, 0, rows.size());
+        } else if (posting.blocks.size() > 1) {
+            posting.blocks.erase(block);
+        } else {
+            m_postings.erase(found);
+        }
+    }
+}
+
+QVector<TextIndex::Hit> TextIndex::search(QStringView query, int limit, const std::function<bool(int)>& accept) const {
+    QVector<QString> words;
+    forEachWord(query, [&](const QString& word) { words.append(word); });
+    std::sort(words.begin(), words.end());
+    words.erase(std::unique(words.begin(), words.end()), words.end());
+    if (words.isEmpty() || m_documents == 0 || limit <= 0) {
+        return {};
+    }
+
+    // Scores accumulate in a dense array indexed by row; touched lists the rows to collect
+    const float averageLength = float(m_totalLength) / float(m_documents);
+    QVector<float> scores(m_lengths.size(), 0.0f);
+    QVector<int> touched;
+    for (const QString& word : words) {
+        auto it = m_postings.constFind(word);
+        if (it == m_postings.constEnd()) {
+            continue;
+        }
+        const Posting& posting = it.value();
+        const float idf = std::log(1.0f + (m_documents - posting.rows + 0.5f) / (posting.rows + 0.5f));
+        for (const Block& block : posting.blocks) {
+            const char* p = block.data.constData();
+            int row = -1;
+            for (int i = 0; i < block.rows; ++i) {
+                row += int(readVarint(p));
+                const float tf = float(readVarint(p));
+                const float norm = kK1 * (1.0f - kB + kB * float(m_lengths[row]) / averageLength);
+                if (scores[row] == 0.0f) {
+                    touched.append(row);
+                }
+                scores[row] += idf * tf * (kK1 + 1.0f) / (tf + norm);
+            }
+        }
+    }
+
+    QVector<Hit> hits;
+    hits.reserve(touched.size());
+    for (int row : touched) {
+        if (!accept || accept(row)) {
+            hits.append({row, scores[row]});
+        }
+    }
+    auto better = [](const Hit& a, const Hit& b) { return a.score != b.score ? a.score > b.score : a.row < b.row; };
+    if (hits.size() > limit) {
+        std::partial_sort(hits.begin(), hits.begin() + limit, hits.end(), better);
+        hits.resize(limit);
+    } else {
+        std::sort(hits.begin(), hits.end(), better);
+    }
+    return hits;
+}
@@ -0,0 +1,183 @@
+// ============== Tracing.cpp ==============
+#include "tracing.h"
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutex>
+#include <QSaveFile>
+#include <QThread>
+#include <QVector>
+
+namespace {
+
+// A long session at a few thousand spans per second; beyond this events are counted, not kept
+const int kMaxEvents = 1 << 20;
+
+struct Event {
+    const char* name;
+    char phase; // 'X' complete, 'b'/'e' async begin/end
+    int thread;
+    qint64 start;    // ns since Trace::start()
+    qint64 duration; // ns, complete events only
+    quint64 id;      // async events only
+    const char* argName;
+    qint64 argValue;
+    QString detail;
+};
+
+struct TraceState {
+    QMutex mutex;
+    QElapsedTimer clock;
+    QVector<Event> events;
+    QHash<int, QString> threadNames;
+    int nextThread = 0;
+    qint64 dropped = 0;
+    std::atomic<quint64> nextAsyncId{0};
+};
+
+TraceState& state() {
+    static TraceState s;
+    return s;
+}
+
+// Small stable numbers per thread read better in the viewer than native handles
+thread_local int t_thread = 0;
+
+int currentThread(TraceState& s) {
+    // Called with the mutex held
+    if (t_thread == 0) {
+        t_thread = ++s.nextThread;
+        QThread* thread = QThread::currentThread();
+        QString name;
+        if (QCoreApplication::instance() && thread == QCoreApplication::instance()->thread()) {
+            name = "main";
+        } else if (!thread->objectName().isEmpty()) {
+            name = QString("%1 %2").arg(thread->objectName()).arg(t_thread);
+        } else {
+            name = QString("thread %1").arg(t_thread);
+        }
+        s.threadNames.insert(t_thread, name);
+    }
+    return t_thread;
+}
+
+void record(Event event) {
+    TraceState& s = state();
+    QMutexLocker locker(&s.mutex);
+    if (!Trace::isEnabled()) {
+        return; // stopped while this span was open
+    }
+    if (s.events.size() >= kMaxEvents) {
+        ++s.dropped;
+        return;
+    }
+    event.thread = currentThread(s);
+    s.events.append(std::move(event));
+}
+
+} // namespace
+
+void Trace::start() {
+    TraceState& s = state();
+    QMutexLocker locker(&s.mutex);
+    s.events.clear();
+    s.dropped = 0;
+    s.clock.start();
+    s_enabled.store(true, std::memory_order_relaxed);
+}
+
+bool Trace::stop(const QString& path, QString* error) {
+    TraceState& s = state();
+    QVector<Event> events;
+    QHash<int, QString> threadNames;
+    qint64 dropped = 0;
+    {
+        QMutexLocker locker(&s.mutex);
+        s_enabled.store(false, std::memory_order_relaxed);
+        events.swap(s.events);
+        threadNames = s.threadNames;
+        dropped = s.dropped;
+    }
+
+    // Trace Event Format: timestamps and durations in microseconds
+    const qint64 pid = QCoreApplication::applicationPid();
+    QJsonArray traceEvents;
+    const QString processName = QCoreApplication::instance() ? QCoreApplication::applicationName()
+                                                             : QStringLiteral("MovieReviewApp");
+    traceEvents.append(QJsonObject{{"name", "process_name"}, {"ph", "M"}, {"pid", pid}, {"tid", 0},
+                                   {"args", QJsonObject{{"name", processName}}}});
+    for (auto it = threadNames.cbegin(); it != threadNames.cend(); ++it) {
+        traceEvents.append(QJsonObject{{"name", "thread_name"}, {"ph", "M"}, {"pid", pid}, {"tid", it.key()},
+                                       {"args", QJsonObject{{"name", it.value()}}}});
+    }
+    for (const Event& event : std::as_const(events)) {
+        QJsonObject object;
+        object["name"] = QString::fromLatin1(event.name);
+        object["ph"] = QString(QLatin1Char(event.phase));
+        object["pid"] = pid;
+        object["tid"] = event.thread;
+        object["ts"] = event.start / 1000.0;
+        if (event.phase == 'X') {
+            object["cat"] = "app";
+            object["dur"] = event.duration / 1000.0;
+        } else {
+            object["cat"] = "async";
+            object["id"] = QString("0x%1").arg(event.id, 0, 16);
+        }
+        QJsonObject args;
+        if (event.argName) {
+            args[QString::fromLatin1(event.argName)] = event.argValue;
+        }
+        if (!event.detail.isEmpty()) {
+            args["detail"] = event.detail;
+        }
+        if (!args.isEmpty()) {
+            object["args"] = args;
+        }
+        traceEvents.append(object);
+    }
+    QJsonObject root;
+    root["traceEvents"] = traceEvents;
+    root["displayTimeUnit"] = "ms";
+    root["otherData"] = QJsonObject{{"dropped_events", dropped}};
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        if (error) *error = file.errorString();
+        return false;
+    }
+    file.write(QJsonDocument(root).toJson(QJsonDocument::Compact));
+    if (!file.commit()) {
+        if (error) *error = file.errorString();
+        return false;
+    }
+    return true;
+}
+
+qint64 Trace::now() {
+    return state().clock.nsecsElapsed();
+}
+
+void Trace::complete(const char* name, qint64 startNs, const char* argName, qint64 argValue) {
+    const qint64 end = now();
+    record({name, 'X', 0, startNs, end - startNs, 0, argName, argValue, QString()});
+}
+
+quint64 Trace::nextAsyncId() {
+    return ++state().nextAsyncId;
+}
+
+void Trace::asyncBegin(const char* name, quint64 id, const QString& detail) {
+    if (isEnabled()) {
+        record({name, 'b', 0, now(), 0, id, nullptr, 0, detail});
+    }
+}
+
+void Trace::asyncEnd(const char* name, quint64 id, const char* argName, qint64 argValue) {
+    if (isEnabled()) {
+        record({name, 'e', 0, now(), 0, id, argName, argValue, QString()});
+    }
+}
@@ -0,0 +1,82 @@
+// ============== TrigramIndex.cpp ==============
+#include "trigramindex.h"
+#include <algorithm>
+
+QVector<quint64> TrigramIndex::trigramsOf(QStringView text) {
+    QVector<quint64> grams;
+    if (text.size() < 3) {
+        return grams;
+    }
+    // Folding per code unit avoids allocating a folded copy of every string
+    grams.reserve(text.size() - 2);
+    quint64 window = (quint64(text[0].toCaseFolded().unicode()) << 16) | text[1].toCaseFolded().unicode();
+    for (qsizetype i = 2; i < text.size(); ++i) {
+        window = ((window << 16) | text[i].toCaseFolded().unicode()) & 0xFFFFFFFFFFFFull;
+        grams.append(window);
+    }
+    // Each trigram is posted once per row
+    std::sort(grams.begin(), grams.end());
+    grams.erase(std::unique(grams.begin(), grams.end()), grams.end());
+    return grams;
+}
+
+void TrigramIndex::addRow(int row, QStringView text) {
+    for (quint64 gram : trigramsOf(text)) {
+        QVector<int>& list = m_postings[gram];
+        // Rows are usually appended, so the common case is a push_back
+        if (list.isEmpty() || list.last() < row) {
+            list.append(row);
+        } else {
+            list.insert(std::lower_bound(list.begin(), list.end(), row), row);
+        }
+    }
+}
+
+void TrigramIndex::removeRow(int row, QStringView text) {
+    for (quint64 gram : trigramsOf(text)) {
+        auto it = m_postings.find(gram);
+        if (it == m_postings.end()) {
+            continue;
+        }
+        QVector<int>& list = it.value();
+        auto pos = std::lower_bound(list.begin(), list.end(), row);
+        if (pos != list.end() && *pos == row) {
+            list.erase(pos);
+        }
+        if (list.isEmpty()) {
+            m_postings.erase(it);
+        }
+    }
+}
+
+QVector<int> TrigramIndex::candidates(QStringView query) const {
+    const QVector<quint64> grams = trigramsOf(query);
+    if (grams.isEmpty()) {
+        return {};
+    }
+
+    // Intersect starting from the shortest posting list
+    QVector<const QVector<int>*> lists;
+    lists.reserve(grams.size());
+    for (quint64 gram : grams) {
+        auto it = m_postings.constFind(gram);
+        if (it == m_postings.constEnd()) {
+            return {};
+        }
+        lists.append(&it.value());
+    }
+    std::sort(lists.begin(), lists.end(), [](const QVector<int>* a, const QVector<int>* b) {
+        return a->size() < b->size();
+    });
+
+    QVector<int> result = *lists.first();
+    QVector<int> next;
+    for (int i = 1; i < lists.size() && !result.isEmpty(); ++i) {
+        next.clear();
+        std::set_intersection(result.begin(), result.end(),
+                              lists[i]->begin(), lists[i]->end(),
+                              std::back_inserter(next));
+        result.swap(next);
+    }
+    return result;
+}
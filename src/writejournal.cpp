@@ -0,0 +1,169 @@
+// ============== WriteJournal.cpp ==============
+#include "writejournal.h"
+#include <QDir>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+
+#ifdef Q_OS_WIN
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace {
+
+bool syncToDisk(QFile& file) {
+    if (!file.flush()) {
+        return false;
+    }
+#ifdef Q_OS_WIN
+    return _commit(file.handle()) == 0;
+#else
+    return ::fsync(file.handle()) == 0;
+#endif
+}
+
+const char* opName(WriteJournal::Op op) {
+    switch (op) {
+    case WriteJournal::Create: return "create";
+    case WriteJournal::Update: return "update";
+    case WriteJournal::Delete: return "delete";
+    }
+    return "";
+}
+
+} // namespace
+
+QByteArray WriteJournal::encode(const Entry& entry) {
+    QJsonObject obj;
+    obj["seq"] = entry.seq;
+    obj["op"] = opName(entry.op);
+    if (entry.op != Create) {
+        obj["original"] = entry.original.toJson();
+    }
+    if (entry.op != Delete) {
+        obj["movie"] = entry.movie.toJson();
+    }
+    return QJsonDocument(obj).toJson(QJsonDocument::Compact) + '\n';
+}
+
+bool WriteJournal::decode(const QByteArray& line, Entry& entry, qint64& ack) {
+    QJsonParseError parseError;
+    const QJsonDocument doc = QJsonDocument::fromJson(line, &parseError);
+    if (parseError.error != QJsonParseError::NoError || !doc.isObject()) {
+        return false;
+    }
+    const QJsonObject obj = doc.object();
+    ack = obj.value("ack").toInteger(0);
+    if (ack > 0) {
+        return true;
+    }
+    const QString op = obj.value("op").toString();
+    if (op == "create") {
+        entry.op = Create;
+    } else if (op == "update") {
+        entry.op = Update;
+    } else if (op == "delete") {
+        entry.op = Delete;
+    } else {
+        return false;
+    }
+    entry.seq = obj.value("seq").toInteger();
+    entry.original = Movie::fromJson(obj.value("original").toObject());
+    entry.movie = Movie::fromJson(obj.value("movie").toObject());
+    return entry.seq > 0;
+}
+
+bool WriteJournal::open(const QString& path, QString* error) {
+    close();
+    QDir().mkpath(QFileInfo(path).absolutePath());
+
+    QFile existing(path);
+    if (existing.open(QIODevice::ReadOnly)) {
+        while (!existing.atEnd()) {
+            const QByteArray line = existing.readLine();
+            Entry entry;
+            qint64 ack = 0;
+            if (!line.endsWith('\n') || !decode(line, entry, ack)) {
+                break; // torn or damaged tail: everything before it is intact
+            }
+            if (ack > 0) {
+                while (!m_pending.isEmpty() && m_pending.first().seq <= ack) {
+                    m_pending.removeFirst();
+                }
+            } else {
+                m_pending.append(entry);
+                m_nextSeq = qMax(m_nextSeq, entry.seq + 1);
+            }
+        }
+        existing.close();
+    }
+
+    // Start from a compact file holding only the pending entries
+    QSaveFile compacted(path);
+    if (!compacted.open(QIODevice::WriteOnly)) {
+        if (error) *error = compacted.errorString();
+        return false;
+    }
+    for (const Entry& entry : m_pending) {
+        compacted.write(encode(entry));
+    }
+    if (!compacted.commit()) {
+        if (error) *error = compacted.errorString();
+        return false;
+    }
+
+    m_file.setFileName(path);
+    if (!m_file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        if (error) *error = m_file.errorString();
+        return false;
+    }
+    return true;
+}
+
+void WriteJournal::close() {
+    m_file.close();
+    m_pending.clear();
+    m_nextSeq = 1;
+}
+
+bool WriteJournal::writeDurably(const QByteArray& line, QString* error) {
+    if (m_file.write(line) != line.size() || !syncToDisk(m_file)) {
+        if (error) *error = "Cannot write journal: " + m_file.errorString();
+        return false;
+    }
+    return true;
+}
+
+bool WriteJournal::append(Entry& entry, QString* error) {
+    if (!isOpen()) {
+        if (error) *error = "Journal is not open";
+        return false;
+    }
+    entry.seq = m_nextSeq;
+    if (!writeDurably(encode(entry), error)) {
+        return false;
+    }
+    ++m_nextSeq;
+    m_pending.append(entry);
+    return true;
+}
+
+bool WriteJournal::acknowledge(qint64 seq, QString* error) {
+    while (!m_pending.isEmpty() && m_pending.first().seq <= seq) {
+        m_pending.removeFirst();
+    }
+    if (m_pending.isEmpty()) {
+        // Nothing left to replay: start the file over instead of growing it forever
+        if (!m_file.resize(0) || !syncToDisk(m_file)) {
+            if (error) *error = "Cannot truncate journal: " + m_file.errorString();
+            return false;
+        }
+        return true;
+    }
+    QJsonObject ack;
+    ack["ack"] = seq;
+    return writeDurably(QJsonDocument(ack).toJson(QJsonDocument::Compact) + '\n', error);
+}
@@ -0,0 +1,547 @@
+// ============== MovieCtl.cpp ==============
+// moviectl: headless bulk operations against the movie API, built on movie_core.
+//
+//   moviectl query  [--name text] [--director text] [--from date] [--to date] [--favorites]
+//                   [--sort date_desc] [--limit n] [--format jsonl|json|csv] [--output file]
+//   moviectl export [--format csv|jsonl|json] [--output file]
+//   moviectl import <file> [--format csv|jsonl|json] [--batch n] [--skip-existing] [--dry-run]
+//   moviectl diff   <file> [--format csv|jsonl|json] [--output-format text|jsonl]
+//
+// Common options: --api URL (default $MOVIE_API_URL or http://127.0.0.1:8000), --cbor.
+// Results stream page by page, so output starts after the first page, whatever the total.
+// Exit status: 0 success (diff: no differences), 1 failures (diff: differences), 2 usage or I/O errors.
+#include "moviecsv.h"
+#include "moviedatabase.h"
+#include "moviejsonstream.h"
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QEventLoop>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+#include <QSet>
+#include <QTextStream>
+#include <functional>
+#include <memory>
+
+namespace {
+
+const int kPageSize = 1000; // the API's maximum page
+
+enum Format { Csv, JsonLines, JsonArray };
+
+bool parseFormat(const QString& name, Format& format) {
+    if (name == "csv") {
+        format = Csv;
+    } else if (name == "jsonl" || name == "ndjson") {
+        format = JsonLines;
+    } else if (name == "json") {
+        format = JsonArray;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// Format from --format, else from the file extension, else the fallback
+bool chooseFormat(const QString& option, const QString& path, Format fallback, Format& format) {
+    if (!option.isEmpty()) {
+        return parseFormat(option, format);
+    }
+    if (!parseFormat(QFileInfo(path).suffix().toLower(), format)) {
+        format = fallback;
+    }
+    return true;
+}
+
+QTextStream& err() {
+    static QTextStream stream(stderr);
+    return stream;
+}
+
+// Writes movies as they arrive to stdout or, atomically on success, to a file
+class MovieSink {
+public:
+    explicit MovieSink(Format format) : m_format(format) {}
+
+    bool open(const QString& path) {
+        if (path.isEmpty() || path == "-") {
+            auto file = std::make_unique<QFile>();
+            if (!file->open(stdout, QIODevice::WriteOnly)) {
+                return false;
+            }
+            m_device = std::move(file);
+        } else {
+            auto file = std::make_unique<QSaveFile>(path);
+            if (!file->open(QIODevice::WriteOnly)) {
+                err() << "Cannot write " << path << ": " << file->errorString() << "\n";
+                return false;
+            }
+            m_device = std::move(file);
+        }
+        if (m_format == Csv) {
+            m_buffer = MovieCsv::header() + '\n';
+        } else if (m_format == JsonArray) {
+            m_buffer = "[";
+        }
+        return true;
+    }
+
+    void write(const MovieStore& store, int row) {
+        switch (m_format) {
+        case Csv:
+            MovieCsv::appendRecord(m_buffer, store, row);
+            m_buffer += '\n';
+            break;
+        case JsonLines:
+            m_buffer += QJsonDocument(store.movie(row).toJson()).toJson(QJsonDocument::Compact);
+            m_buffer += '\n';
+            break;
+        case JsonArray:
+            m_buffer += m_count == 0 ? "\n" : ",\n";
+            m_buffer += QJsonDocument(store.movie(row).toJson()).toJson(QJsonDocument::Compact);
+            break;
+        }
+        ++m_count;
+    }
+
+    // Hands the buffered records to the device; called once per page so output streams
+    bool flush() {
+        if (m_device->write(m_buffer) != m_buffer.size()) {
+            err() << "Write failed: " << m_device->errorString() << "\n";
+            return false;
+        }
+        m_buffer.clear();
+        m_device->flush();
+        return true;
+    }
+
+    bool close() {
+        if (m_format == JsonArray) {
+            m_buffer += m_count == 0 ? "]\n" : "\n]\n";
+        }
+        if (!flush()) {
+            return false;
+        }
+        if (auto* file = qobject_cast<QSaveFile*>(m_device.get())) {
+            if (!file->commit()) {
+                err() << "Write failed: " << file->errorString() << "\n";
+                return false;
+            }
+        }
+        return true;
+    }
+
+    qint64 count() const { return m_count; }
+
+private:
+    Format m_format;
+    std::unique_ptr<QFileDevice> m_device;
+    QByteArray m_buffer;
+    qint64 m_count = 0;
+};
+
+bool readMovies(const QString& path, Format format, MovieStore& out, QString& error) {
+    QFile file;
+    if (path == "-") {
+        file.open(stdin, QIODevice::ReadOnly);
+    } else {
+        file.setFileName(path);
+        if (format == Csv) {
+            return MovieCsv::readFile(path, out, &error); // mapped and parsed on all cores
+        }
+        if (!file.open(QIODevice::ReadOnly)) {
+            error = file.errorString();
+            return false;
+        }
+    }
+    if (format == Csv) {
+        const QByteArray data = file.readAll();
+        return MovieCsv::parse(data.constData(), data.size(), out, &error);
+    }
+    if (format == JsonArray) {
+        MovieJsonStream stream;
+        while (!file.atEnd()) {
+            if (!stream.feed(file.read(1 << 20))) {
+                break;
+            }
+        }
+        if (!stream.finish()) {
+            error = stream.errorString();
+            return false;
+        }
+        out = stream.takeStore();
+        return true;
+    }
+    qint64 lineNumber = 0;
+    while (!file.atEnd()) {
+        const QByteArray line = file.readLine().trimmed();
+        ++lineNumber;
+        if (line.isEmpty()) {
+            continue;
+        }
+        QJsonParseError parseError;
+        const QJsonDocument doc = QJsonDocument::fromJson(line, &parseError);
+        if (!doc.isObject()) {
+            error = QString("line %1: %2").arg(lineNumber).arg(parseError.errorString());
+            return false;
+        }
+        out.append(Movie::fromJson(doc.object()));
+    }
+    return true;
+}
+
+QString describe(const Movie& movie) {
+    return QString("%1 (%2)").arg(movie.getName()).arg(movie.getYear());
+}
+
+QString duplicateKey(const QString& name, int year) {
+    return name.trimmed().toLower() + QChar(0x1f) + QString::number(year);
+}
+
+} // namespace
+
+class MovieCtl {
+public:
+    MovieCtl(const QString& apiUrl, bool cbor) : m_database(apiUrl) { m_database.setPreferCbor(cbor); }
+
+    int query(const MovieQuery& query, MovieDatabase::SortKey key, bool descending, qint64 limit,
+              Format format, const QString& output);
+    int import(const QString& path, Format format, int batch, bool skipExisting, bool dryRun);
+    int diff(const QString& path, Format format, bool jsonOutput);
+
+private:
+    // Fetches the query's pages in order and hands each to onPage, which returns false to stop
+    bool forEachPage(const MovieQuery& query, MovieDatabase::SortKey key, bool descending, qint64 limit,
+                     const std::function<bool(const MovieStore& page)>& onPage);
+
+    MovieDatabase m_database;
+};
+
+bool MovieCtl::forEachPage(const MovieQuery& query, MovieDatabase::SortKey key, bool descending, qint64 limit,
+                           const std::function<bool(const MovieStore& page)>& onPage) {
+    QString cursor;
+    qint64 remaining = limit;
+    do {
+        const int pageSize = int(limit < 0 ? kPageSize : qMin<qint64>(kPageSize, remaining));
+        bool ok = false;
+        QString error;
+        MovieStore page;
+        QString next;
+        QEventLoop loop;
+        m_database.fetchPageAsync(query, key, descending, cursor, pageSize,
+                                  [&](bool pageOk, const QString& pageError, const MovieStore& movies,
+                                      const QString& nextCursor) {
+            ok = pageOk;
+            error = pageError;
+            page = movies;
+            next = nextCursor;
+            loop.quit();
+        });
+        loop.exec();
+        if (!ok) {
+            err() << "Request failed: " << error << "\n";
+            return false;
+        }
+        if (!onPage(page)) {
+            return false;
+        }
+        remaining -= page.size();
+        cursor = next;
+    } while (!cursor.isEmpty() && remaining != 0);
+    return true;
+}
+
+int MovieCtl::query(const MovieQuery& query, MovieDatabase::SortKey key, bool descending, qint64 limit,
+                    Format format, const QString& output) {
+    MovieSink sink(format);
+    if (!sink.open(output)) {
+        return 2;
+    }
+    const bool ok = forEachPage(query, key, descending, limit, [&sink](const MovieStore& page) {
+        for (int row = 0; row < page.size(); ++row) {
+            sink.write(page, row);
+        }
+        return sink.flush();
+    });
+    if (!sink.close()) {
+        return 2;
+    }
+    err() << sink.count() << " movies\n";
+    return ok ? 0 : 1;
+}
+
+int MovieCtl::import(const QString& path, Format format, int batch, bool skipExisting, bool dryRun) {
+    MovieStore movies;
+    QString error;
+    if (!readMovies(path, format, movies, error)) {
+        err() << "Cannot read " << path << ": " << error << "\n";
+        return 2;
+    }
+    // The existing collection is needed to skip what is already there; without it the
+    // server reports duplicates as failed rows
+    if (skipExisting && !m_database.loadFromApi()) {
+        err() << "Cannot load the collection: " << m_database.getLastError() << "\n";
+        return 1;
+    }
+
+    // Writes go out as POST /movies/batch requests of up to batch movies, with a few in
+    // flight, so a large file neither waits on one request at a time nor floods the queue
+    m_database.setWriteCoalescing(20, batch);
+    const int maxInFlight = batch * 4;
+    int next = 0;
+    int inFlight = 0;
+    int imported = 0;
+    int skipped = 0;
+    int failed = 0;
+    QSet<QString> wouldImport; // a dry run adds nothing locally, so its repeats are tracked here
+    QEventLoop loop;
+    std::function<void()> pump = [&]() {
+        while (next < movies.size() && inFlight < maxInFlight) {
+            const int row = next++;
+            const Movie movie = movies.movie(row);
+            if (skipExisting && m_database.findDuplicate(movie.getName(), movie.getYear()) >= 0) {
+                ++skipped; // confirmed imports are added locally, so later repeats in the file skip too
+                continue;
+            }
+            if (dryRun && skipExisting && !wouldImport.insert(duplicateKey(movie.getName(), movie.getYear()))) {
+                ++skipped;
+                continue;
+            }
+            if (dryRun) {
+                QTextStream(stdout) << "would import " << describe(movie) << "\n";
+                ++imported;
+                continue;
+            }
+            ++inFlight;
+            m_database.addMovieAsync(movie, [&, row, movie](bool ok, const QString& detail) {
+                --inFlight;
+                if (ok) {
+                    ++imported;
+                } else {
+                    ++failed;
+                    err() << "record " << row + 1 << ": " << describe(movie) << ": " << detail << "\n";
+                }
+                pump();
+            });
+        }
+        if (next >= movies.size() && inFlight == 0) {
+            loop.quit();
+        }
+    };
+    QMetaObject::invokeMethod(&loop, pump, Qt::QueuedConnection);
+    loop.exec();
+
+    err() << (dryRun ? "Would import " : "Imported ") << imported << ", skipped " << skipped
+          << ", failed " << failed << " of " << movies.size() << "\n";
+    return failed == 0 ? 0 : 1;
+}
+
+int MovieCtl::diff(const QString& path, Format format, bool jsonOutput) {
+    MovieStore local;
+    QString error;
+    if (!readMovies(path, format, local, error)) {
+        err() << "Cannot read " << path << ": " << error << "\n";
+        return 2;
+    }
+    // Movies match by case-insensitive name and year, like the server's duplicate check.
+    // The first row with a key is compared; later ones are duplicates within the file.
+    QHash<QString, int> localRows;
+    localRows.reserve(local.size());
+    QVector<bool> repeated(local.size(), false);
+    for (int row = 0; row < local.size(); ++row) {
+        const QString key = duplicateKey(local.movie(row).getName(), local.movie(row).getYear());
+        if (localRows.contains(key)) {
+            repeated[row] = true;
+        } else {
+            localRows.insert(key, row);
+        }
+    }
+    QVector<bool> seen(local.size(), false);
+
+    QTextStream out(stdout);
+    qint64 differences = 0;
+    auto report = [&](const char* change, const Movie& movie, const Movie* server, const QStringList& fields) {
+        ++differences;
+        if (jsonOutput) {
+            QJsonObject object;
+            object["change"] = QString::fromLatin1(change);
+            object["movie"] = movie.toJson();
+            if (server) {
+                object["server"] = server->toJson();
+                object["fields"] = QJsonArray::fromStringList(fields);
+            }
+            out << QJsonDocument(object).toJson(QJsonDocument::Compact) << "\n";
+        } else {
+            const char* sign = server ? "~"
+                : qstrcmp(change, "added") == 0 ? "+"
+                : qstrcmp(change, "duplicate") == 0 ? "!" : "-";
+            out << sign << ' ' << describe(movie);
+            if (!fields.isEmpty()) {
+                out << ": " << fields.join(", ");
+            }
+            out << "\n";
+        }
+    };
+
+    // Server movies stream past once, page by page; only the file is held in memory.
+    // "removed" means on the server but not in the file, "added" in the file only.
+    const bool ok = forEachPage(MovieQuery(), MovieDatabase::SortByName, false, -1, [&](const MovieStore& page) {
+        for (int row = 0; row < page.size(); ++row) {
+            const Movie server = page.movie(row);
+            const int localRow = localRows.value(duplicateKey(server.getName(), server.getYear()), -1);
+            if (localRow < 0) {
+                report("removed", server, nullptr, {});
+                continue;
+            }
+            seen[localRow] = true;
+            const Movie movie = local.movie(localRow);
+            QStringList fields;
+            if (movie.getDirector().trimmed() != server.getDirector()) fields << "director";
+            if (movie.getNotes().trimmed() != server.getNotes()) fields << "notes";
+            if (movie.isFavorite() != server.isFavorite()) fields << "favorite";
+            if (movie.getDateAdded().isValid() && movie.getDateAdded() != server.getDateAdded()) fields << "date_added";
+            if (!fields.isEmpty()) {
+                report("changed", movie, &server, fields);
+            }
+        }
+        out.flush();
+        return true;
+    });
+    if (!ok) {
+        return 2;
+    }
+    for (int row = 0; row < local.size(); ++row) {
+        if (repeated[row]) {
+            report("duplicate", local.movie(row), nullptr, {}); // the server would refuse it (409)
+        } else if (!seen[row]) {
+            report("added", local.movie(row), nullptr, {});
+        }
+    }
+    out.flush();
+    err() << differences << " differences\n";
+    return differences == 0 ? 0 : 1;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    app.setApplicationName("moviectl");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Bulk query, export, import and diff against the movie API.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("command", "query, export, import or diff");
+    QCommandLineOption apiOption("api", "API base URL.", "url",
+                                 qEnvironmentVariable("MOVIE_API_URL", "http://127.0.0.1:8000"));
+    QCommandLineOption cborOption("cbor", "Ask for CBOR on bulk reads.");
+    QCommandLineOption formatOption("format", "csv, jsonl or json (default: from the file name).", "format");
+    QCommandLineOption outputOption("output", "Write here instead of stdout.", "file");
+    parser.addOptions({apiOption, cborOption, formatOption, outputOption});
+    parser.parse(app.arguments());
+
+    const QString command = parser.positionalArguments().value(0);
+    QCommandLineOption nameOption("name", "Name contains.", "text");
+    QCommandLineOption directorOption("director", "Director contains.", "text");
+    QCommandLineOption fromOption("from", "Added on or after (yyyy-MM-dd).", "date");
+    QCommandLineOption toOption("to", "Added on or before (yyyy-MM-dd).", "date");
+    QCommandLineOption favoritesOption("favorites", "Favorites only.");
+    QCommandLineOption sortOption("sort", "date_desc, date_asc, name_asc, name_desc, year_desc or year_asc.",
+                                  "order", "date_desc");
+    QCommandLineOption limitOption("limit", "At most this many movies.", "n");
+    QCommandLineOption batchOption("batch", "Movies per batch request.", "n", "200");
+    QCommandLineOption skipOption("skip-existing", "Skip movies whose name and year already exist.");
+    QCommandLineOption dryRunOption("dry-run", "Only report what would be imported.");
+    QCommandLineOption diffFormatOption("output-format", "text or jsonl.", "format", "text");
+    if (command == "query") {
+        parser.clearPositionalArguments();
+        parser.addPositionalArgument("query", "Filtered, sorted listing; streams page by page.");
+        parser.addOptions({nameOption, directorOption, fromOption, toOption, favoritesOption, sortOption,
+                           limitOption});
+    } else if (command == "export") {
+        parser.clearPositionalArguments();
+        parser.addPositionalArgument("export", "The whole collection, oldest first; CSV by default.");
+    } else if (command == "import" || command == "diff") {
+        parser.clearPositionalArguments();
+        parser.addPositionalArgument(command, command == "import" ? "Adds the movies of a file."
+                                                                  : "Compares a file with the server.");
+        parser.addPositionalArgument("file", "CSV, JSON lines or a JSON array; - for stdin.");
+        if (command == "import") {
+            parser.addOptions({batchOption, skipOption, dryRunOption});
+        } else {
+            parser.addOption(diffFormatOption);
+        }
+    }
+    parser.process(app);
+
+    MovieCtl ctl(parser.value(apiOption), parser.isSet(cborOption));
+    const QString formatName = parser.value(formatOption);
+    Format format = Csv;
+
+    if (command == "query" || command == "export") {
+        MovieQuery query;
+        MovieDatabase::SortKey key = MovieDatabase::SortByDateAdded;
+        bool descending = false;
+        qint64 limit = -1;
+        Format fallback = Csv;
+        if (command == "query") {
+            query.nameContains = parser.value(nameOption);
+            query.directorContains = parser.value(directorOption);
+            query.addedFrom = QDate::fromString(parser.value(fromOption), Qt::ISODate);
+            query.addedTo = QDate::fromString(parser.value(toOption), Qt::ISODate);
+            query.favoritesOnly = parser.isSet(favoritesOption);
+            const QString sort = parser.value(sortOption);
+            descending = sort.endsWith("_desc");
+            key = sort.startsWith("name") ? MovieDatabase::SortByName
+                : sort.startsWith("year") ? MovieDatabase::SortByYear : MovieDatabase::SortByDateAdded;
+            if (parser.isSet(limitOption)) {
+                bool ok = false;
+                limit = parser.value(limitOption).toLongLong(&ok);
+                if (!ok || limit <= 0) {
+                    err() << "Invalid --limit\n";
+                    return 2;
+                }
+            }
+            fallback = JsonLines;
+        }
+        if (!chooseFormat(formatName, parser.value(outputOption), fallback, format)) {
+            err() << "Unknown format: " << formatName << "\n";
+            return 2;
+        }
+        return ctl.query(query, key, descending, limit, format, parser.value(outputOption));
+    }
+    if (command == "import" || command == "diff") {
+        const QStringList args = parser.positionalArguments();
+        if (args.size() != 2) {
+            parser.showHelp(2);
+        }
+        const QString path = args[1];
+        if (!chooseFormat(formatName, path, Csv, format)) {
+            err() << "Unknown format: " << formatName << "\n";
+            return 2;
+        }
+        if (command == "import") {
+            const int batch = parser.value(batchOption).toInt();
+            if (batch < 1 || batch > 1000) {
+                err() << "--batch must be between 1 and 1000\n";
+                return 2;
+            }
+            return ctl.import(path, format, batch, parser.isSet(skipOption), parser.isSet(dryRunOption));
+        }
+        const QString output = parser.value(diffFormatOption);
+        if (output != "text" && output != "jsonl") {
+            err() << "Unknown --output-format: " << output << "\n";
+            return 2;
+        }
+        return ctl.diff(path, format, output == "jsonl");
+    }
+    if (command.isEmpty()) {
+        parser.showHelp(2);
+    }
+    err() << "Unknown command: " << command << "\n";
+    return 2;
+}